@@ -0,0 +1,93 @@
+CONFIG  += c++11
+QT      += core gui widgets concurrent
+LIBS    += -lz
+
+TARGET = icefloorplan
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# With `qmake CONFIG+=bmi2`, tile bits are extracted with pext, which is faster on CPUs that
+# have a fast one (Intel since Haswell, AMD since Zen 3); the executable then needs BMI2.
+bmi2:!msvc: QMAKE_CXXFLAGS += -mbmi2
+
+SOURCES += \
+    main.cpp \
+    floorplanwindow.cpp \
+    floorplanwidget.cpp \
+    chipdb.cpp \
+    extractplan.cpp \
+    ascparser.cpp \
+    binparser.cpp \
+    gzipdevice.cpp \
+    bitstream.cpp \
+    netgraph.cpp \
+    symbolindex.cpp \
+    chipdbloader.cpp \
+    chipdbregistry.cpp \
+    chipdbimage.cpp \
+    bitstreamloader.cpp \
+    bitstreamdiff.cpp \
+    bitstreamfileloader.cpp \
+    diffloader.cpp \
+    reloadloader.cpp \
+    circuitbuilder.cpp \
+    floorplanbuilder.cpp
+
+HEADERS += \
+    floorplanwindow.h \
+    floorplanwidget.h \
+    chipdb.h \
+    tilegrid.h \
+    unionfind.h \
+    packedbits.h \
+    extractplan.h \
+    ascparser.h \
+    binparser.h \
+    gzipdevice.h \
+    bitstream.h \
+    netgraph.h \
+    symbolindex.h \
+    chipdbloader.h \
+    chipdbregistry.h \
+    chipdbimage.h \
+    boundedqueue.h \
+    loadprogress.h \
+    bitstreamloader.h \
+    bitstreamdiff.h \
+    bitstreamfileloader.h \
+    diffloader.h \
+    reloadloader.h \
+    circuitbuilder.h \
+    floorplanbuilder.h
+
+FORMS += \
+    floorplanwindow.ui
+
+RESOURCES += \
+    builtins.qrc
+
+# Compile the chipdbs into the executable, so that the built-in devices need no parsing. They
+# are compiled by tools/chipdbgen, which is built first by icefloorplan.pro.
+CHIPDBGEN = $$OUT_PWD/tools/chipdbgen/chipdbgen
+win32: CHIPDBGEN = $$OUT_PWD/tools/chipdbgen/chipdbgen.exe
+
+CHIPDBS = $$files($$PWD/chipdb/chipdb-*.txt) $$files($$PWD/chipdb/chipdb-*.txt.gz)
+isEmpty(CHIPDBS): warning("No chipdbs found in $$PWD/chipdb; no devices will be built in.")
+
+chipdbgen.input        = CHIPDBS
+chipdbgen.output       = ${QMAKE_FILE_BASE}.cpp
+chipdbgen.commands     = $$shell_path($$CHIPDBGEN) ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT}
+chipdbgen.depends      = $$CHIPDBGEN
+chipdbgen.variable_out = SOURCES
+chipdbgen.name         = chipdbgen ${QMAKE_FILE_IN}
+
+chipdbindex.input        = CHIPDBS
+chipdbindex.output       = builtinchipdbs.cpp
+chipdbindex.commands     = $$shell_path($$CHIPDBGEN) --index ${QMAKE_FILE_OUT} ${QMAKE_FILE_IN}
+chipdbindex.depends      = $$CHIPDBGEN
+chipdbindex.variable_out = SOURCES
+chipdbindex.CONFIG       = combine
+chipdbindex.name         = chipdbgen --index
+
+QMAKE_EXTRA_COMPILERS += chipdbgen chipdbindex
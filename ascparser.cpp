@@ -1,8 +1,113 @@
 #include <QtDebug>
+#include <QFileDevice>
+#include <algorithm>
+#include <cstring>
 #include "ascparser.h"
 
-AscParser::AscParser(QIODevice *in) : _in(in), _lineno(-1), _error(false)
-{}
+static const qint64 READ_SIZE = 1 << 16;
+
+static const struct {
+    const char *name;
+    AscParser::Command command;
+} COMMANDS[] = {
+    {"comment", AscParser::Comment},
+    {"device", AscParser::Device},
+    {"pins", AscParser::Pins},
+    {"gbufin", AscParser::GBufIn},
+    {"gbufpin", AscParser::GBufPin},
+    {"iolatch", AscParser::IOLatch},
+    {"ieren", AscParser::IERen},
+    {"colbuf", AscParser::ColBuf},
+    {"io_tile", AscParser::IOTile},
+    {"logic_tile", AscParser::LogicTile},
+    {"ramb_tile", AscParser::RAMBTile},
+    {"ramt_tile", AscParser::RAMTTile},
+    {"dsp0_tile", AscParser::DSP0Tile},
+    {"dsp1_tile", AscParser::DSP1Tile},
+    {"dsp2_tile", AscParser::DSP2Tile},
+    {"dsp3_tile", AscParser::DSP3Tile},
+    {"ipcon_tile", AscParser::IPConTile},
+    {"io_tile_bits", AscParser::IOTileBits},
+    {"logic_tile_bits", AscParser::LogicTileBits},
+    {"ramb_tile_bits", AscParser::RAMBTileBits},
+    {"ramt_tile_bits", AscParser::RAMTTileBits},
+    {"dsp0_tile_bits", AscParser::DSP0TileBits},
+    {"dsp1_tile_bits", AscParser::DSP1TileBits},
+    {"dsp2_tile_bits", AscParser::DSP2TileBits},
+    {"dsp3_tile_bits", AscParser::DSP3TileBits},
+    {"ipcon_tile_bits", AscParser::IPConTileBits},
+    {"extra_cell", AscParser::ExtraCell},
+    {"extra_bits", AscParser::ExtraBits},
+    {"extra_bit", AscParser::ExtraBit},
+    {"net", AscParser::Net},
+    {"buffer", AscParser::Buffer},
+    {"routing", AscParser::Routing},
+    {"ram_data", AscParser::RAMData},
+    {"sym", AscParser::Sym},
+};
+
+static bool isDecimalChar(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool isBinaryChar(char c)
+{
+    return c == '0' || c == '1';
+}
+
+static bool isCommandChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool isNameStartChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '$' || c == '\\';
+}
+
+static bool isNameChar(char c)
+{
+    return isNameStartChar(c) || c == '_' || c == '/' || c == '[' || c == ']' || c == '.' ||
+           c == ':';
+}
+
+AscParser::AscParser(QIODevice *in)
+    : _in(in), _map(nullptr), _streaming(false), _consumed(0), _lineno(-1), _error(false),
+      _command("")
+{
+    qint64 offset = in->pos();
+    qint64 length = in->size() - offset;
+    if(QFileDevice *file = qobject_cast<QFileDevice *>(in)) {
+        if(length > 0) _map = file->map(offset, length);
+    }
+
+    if(_map) {
+        _begin = reinterpret_cast<const char *>(_map);
+        _end   = _begin + length;
+    } else {
+        _streaming = true;
+        _begin     = _end = _data.constData();
+    }
+
+    _next = _line = _lineEnd = _cur = _begin;
+    readNextLine();
+}
+
+AscParser::AscParser(const Chunk &chunk)
+    : _in(nullptr), _map(nullptr), _streaming(false), _consumed(0), _begin(chunk.begin),
+      _end(chunk.end), _lineno(chunk.lineno - 1), _error(false), _command("")
+{
+    _next = _line = _lineEnd = _cur = _begin;
+}
+
+AscParser::~AscParser()
+{
+    if(_map) {
+        static_cast<QFileDevice *>(_in)->unmap(_map);
+    }
+}
 
 bool AscParser::isOk() const
 {
@@ -11,116 +116,279 @@ bool AscParser::isOk() const
 
 bool AscParser::atEnd() const
 {
-    return _in->bytesAvailable() == 0;
+    return _next == _end && _cur == _lineEnd;
 }
 
-void AscParser::refill()
+qint64 AscParser::pos() const
 {
-    if(_pos < _line.length()) return;
-    _pos = 0;
+    return _consumed + (_next - _begin);
+}
 
-    _line = _in->readLine();
-    _lineno++;
-    // qDebug() << "read" << _line;
-    while(_line == "\n" || _line[0] == '#') {
-        _line = _in->readLine();
-        _lineno++;
-        // qDebug() << "read" << _line;
-    }
+qint64 AscParser::linePos() const
+{
+    return _consumed + (_line - _begin);
 }
 
-QRegularExpressionMatch AscParser::matchRegexp(const QRegularExpression &re)
+int AscParser::lineNumber() const
 {
-    refill();
+    return _lineno;
+}
 
-    QRegularExpressionMatch match = re.match(_line, _pos, QRegularExpression::NormalMatch,
-                                             QRegularExpression::AnchoredMatchOption);
-    if(!match.hasMatch()) {
-        _error = true;
-        qCritical() << "at line" << _lineno << "cannot match" << re.pattern() << "on"
-                    << _line.mid(_pos);
+qint64 AscParser::size() const
+{
+    if(_streaming) {
+        return qMax(_consumed + (_end - _begin), _in->size());
     } else {
-        _pos += match.capturedLength();
+        return _end - _begin;
     }
-    return match;
 }
 
-QRegularExpressionMatch AscParser::matchToken(const QRegularExpression &re)
+void AscParser::readToEnd()
 {
-    QRegularExpressionMatch match = matchRegexp(re);
-    if(match.hasMatch()) {
-        while(_line[_pos] == ' ' || _line[_pos] == '\n') {
-            _pos++;
+    if(_streaming) {
+        while(readMore(-1)) {}
+    }
+}
+
+bool AscParser::readMore(qint64 maxSize)
+{
+    QByteArray chunk = maxSize < 0 ? _in->readAll() : _in->read(maxSize);
+    if(chunk.isEmpty()) {
+        if(!_in->atEnd() && !_error) {
+            _error = true;
+            qCritical() << "cannot read input after line" << _lineno;
         }
+        return false;
     }
-    return match;
+
+    // Keep the current line and drop the ones before it.
+    qint64 dropped = _line - _begin;
+    qint64 line    = _lineEnd - _line, cur = _cur - _line, next = _next - _line;
+    _data.remove(0, dropped);
+    _data.append(chunk);
+    _consumed += dropped;
+
+    _begin   = _line = _data.constData();
+    _end     = _begin + _data.size();
+    _lineEnd = _line + line;
+    _cur     = _line + cur;
+    _next    = _line + next;
+    return true;
+}
+
+void AscParser::readNextLine()
+{
+    if(!_streaming) return;
+
+    while(!memchr(_next, '\n', _end - _next) && readMore(READ_SIZE)) {}
+}
+
+QVector<AscParser::Chunk> AscParser::splitAtCommands(int count) const
+{
+    QVector<Chunk> chunks;
+
+    const char *begin = _cur < _lineEnd ? _cur : _next;
+    int lineno        = _cur < _lineEnd ? _lineno : _lineno + 1;
+    for(int i = 1; i <= count && begin != _end; i++) {
+        const char *end = _end;
+        if(i < count) {
+            // Find the first line starting with a command at or after the split point.
+            end = begin + qMax<qint64>(1, (_end - begin) / (count - i + 1));
+            while(end != _end && !(end[-1] == '\n' && end[0] == '.')) {
+                const char *nl = static_cast<const char *>(memchr(end, '\n', _end - end));
+                end            = nl ? nl + 1 : _end;
+            }
+        }
+
+        chunks.append(Chunk{begin, end, lineno});
+        lineno += std::count(begin, end, '\n');
+        begin = end;
+    }
+
+    return chunks;
+}
+
+void AscParser::refill()
+{
+    if(_cur < _lineEnd) return;
+
+    do {
+        _line          = _next;
+        const char *nl = static_cast<const char *>(memchr(_line, '\n', _end - _line));
+        _lineEnd       = nl ? nl + 1 : _end;
+        _next          = _lineEnd;
+        _cur           = _line;
+        _lineno++;
+        readNextLine();
+    } while(_line != _lineEnd &&
+            (*_line == '#' || *_line == '\n' ||
+             (*_line == '\r' && _lineEnd - _line == 2 && _line[1] == '\n')));
+}
+
+void AscParser::skipSpaces()
+{
+    while(_cur != _lineEnd && (*_cur == ' ' || *_cur == '\r' || *_cur == '\n')) {
+        _cur++;
+    }
+}
+
+void AscParser::fail(const char *pattern)
+{
+    _error = true;
+    qCritical() << "at line" << _lineno << "cannot match" << QLatin1String(pattern) << "on"
+                << QLatin1String(_cur, _lineEnd - _cur);
+}
+
+QLatin1String AscParser::matchToken(const char *pattern, bool (*first)(char), bool (*rest)(char))
+{
+    refill();
+
+    const char *start = _cur;
+    if(_cur == _lineEnd || !first(*_cur)) {
+        fail(pattern);
+        return QLatin1String();
+    }
+
+    do {
+        _cur++;
+    } while(_cur != _lineEnd && rest(*_cur));
+    QLatin1String token(start, _cur - start);
+
+    skipSpaces();
+    return token;
 }
 
 bool AscParser::atEol()
 {
-    return _pos == _line.length();
+    return _cur == _lineEnd;
 }
 
 void AscParser::parseEol()
 {
-    if(_pos < _line.length()) {
+    if(_cur < _lineEnd) {
         _error = true;
-        qCritical() << "at line" << _lineno << "not at end of line:" << _line.mid(_pos)
-                    << "remaining";
+        qCritical() << "at line" << _lineno << "not at end of line:"
+                    << QLatin1String(_cur, _lineEnd - _cur) << "remaining";
     }
 }
 
-QString AscParser::parseRest()
+QLatin1String AscParser::parseRest()
 {
-    QString rest = _line.mid(_pos);
-    _pos         = _line.length();
+    const char *rest = _cur;
+    const char *end  = _lineEnd;
+    _cur             = _lineEnd;
 
-    if(rest.endsWith("\n")) rest.chop(1);
-    return rest;
+    if(end != rest && end[-1] == '\n') end--;
+    if(end != rest && end[-1] == '\r') end--;
+    return QLatin1String(rest, end - rest);
 }
 
 bool AscParser::atCommand()
 {
     refill();
-    return atEnd() || (_pos == 0 && _line[_pos] == '.');
+    return atEnd() || (_cur == _line && _cur != _lineEnd && *_cur == '.');
 }
 
 void AscParser::skipToCommand()
 {
     do {
-        _pos = _line.length();
+        _cur = _lineEnd;
         refill();
     } while(!atEnd() && !atCommand());
 }
 
-QString AscParser::parseCommand()
+AscParser::Command AscParser::parseCommand()
 {
-    static const QRegularExpression re("\\.([a-z0-9_]+)");
-    QRegularExpressionMatch match = matchToken(re);
-    if(!match.hasMatch()) return "";
-    return match.captured(1);
+    static const char PATTERN[] = "\\.([a-z0-9_]+)";
+
+    refill();
+    if(_lineEnd - _cur < 2 || _cur[0] != '.' || !isCommandChar(_cur[1])) {
+        fail(PATTERN);
+        _command = QLatin1String("");
+        return Unknown;
+    }
+
+    _cur++;
+    _command = matchToken(PATTERN, isCommandChar, isCommandChar);
+    for(const auto &entry : COMMANDS) {
+        if(_command == QLatin1String(entry.name)) return entry.command;
+    }
+    return Unknown;
+}
+
+QLatin1String AscParser::commandName() const
+{
+    return _command;
 }
 
 uint AscParser::parseBinary()
 {
-    static const QRegularExpression re("[01]+");
-    QRegularExpressionMatch match = matchToken(re);
-    if(!match.hasMatch()) return 0;
-    return match.capturedRef(0).toUInt(nullptr, 2);
+    QLatin1String token = matchToken("[01]+", isBinaryChar, isBinaryChar);
+
+    uint value = 0;
+    for(int i = 0; i < token.size(); i++) {
+        value = (value << 1) | (token.data()[i] - '0');
+    }
+    return value;
 }
 
 uint AscParser::parseDecimal()
 {
-    static const QRegularExpression re("[0-9]+");
-    QRegularExpressionMatch match = matchToken(re);
-    if(!match.hasMatch()) return 0;
-    return match.capturedRef(0).toUInt(nullptr, 10);
+    QLatin1String token = matchToken("[0-9]+", isDecimalChar, isDecimalChar);
+
+    uint value = 0;
+    for(int i = 0; i < token.size(); i++) {
+        value = value * 10 + (token.data()[i] - '0');
+    }
+    return value;
+}
+
+QLatin1String AscParser::parseName()
+{
+    return matchToken("[A-Za-z0-9$\\\\][A-Za-z0-9_/\\[\\].:$\\\\]*", isNameStartChar, isNameChar);
+}
+
+bool AscParser::isTileCommand(Command command)
+{
+    return command >= IOTile && command <= IPConTile;
+}
+
+bool AscParser::isTileBitsCommand(Command command)
+{
+    return command >= IOTileBits && command <= IPConTileBits;
 }
 
-QString AscParser::parseName()
+QString AscParser::tileType(Command command)
 {
-    static const QRegularExpression re("[A-Za-z0-9$\\\\][A-Za-z0-9_/\\[\\].:$\\\\]*");
-    QRegularExpressionMatch match = matchToken(re);
-    if(!match.hasMatch()) return "";
-    return match.captured(0);
+    switch(command) {
+    case IOTile:
+    case IOTileBits:
+        return "io";
+    case LogicTile:
+    case LogicTileBits:
+        return "logic";
+    case RAMBTile:
+    case RAMBTileBits:
+        return "ramb";
+    case RAMTTile:
+    case RAMTTileBits:
+        return "ramt";
+    case DSP0Tile:
+    case DSP0TileBits:
+        return "dsp0";
+    case DSP1Tile:
+    case DSP1TileBits:
+        return "dsp1";
+    case DSP2Tile:
+    case DSP2TileBits:
+        return "dsp2";
+    case DSP3Tile:
+    case DSP3TileBits:
+        return "dsp3";
+    case IPConTile:
+    case IPConTileBits:
+        return "ipcon";
+    default:
+        return QString();
+    }
 }
@@ -1,41 +1,124 @@
 #ifndef BLIFPARSER_H
 #define BLIFPARSER_H
 
+#include <QByteArray>
 #include <QIODevice>
-#include <QRegularExpression>
+#include <QLatin1String>
+#include <QVector>
 
+// A tokenizer for the IceStorm ASCII formats (chipdb and .asc).
+//
+// The input is memory-mapped when it is a file, and scanned in place. Otherwise, e.g. when it
+// is being decompressed, it is read a chunk at a time as it is parsed. Names returned by
+// parseName(), parseRest() and commandName() point into the input, and are only valid for
+// the lifetime of the parser, or for streamed input, until the next line is parsed.
 class AscParser
 {
 public:
+    enum Command {
+        Unknown,
+        Comment,
+        Device,
+        Pins,
+        GBufIn,
+        GBufPin,
+        IOLatch,
+        IERen,
+        ColBuf,
+        IOTile,
+        LogicTile,
+        RAMBTile,
+        RAMTTile,
+        DSP0Tile,
+        DSP1Tile,
+        DSP2Tile,
+        DSP3Tile,
+        IPConTile,
+        IOTileBits,
+        LogicTileBits,
+        RAMBTileBits,
+        RAMTTileBits,
+        DSP0TileBits,
+        DSP1TileBits,
+        DSP2TileBits,
+        DSP3TileBits,
+        IPConTileBits,
+        ExtraCell,
+        ExtraBits,
+        ExtraBit,
+        Net,
+        Buffer,
+        Routing,
+        RAMData,
+        Sym
+    };
+
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        int lineno;
+    };
+
     AscParser(QIODevice *in);
+    AscParser(const Chunk &chunk);
+    ~AscParser();
+
+    // Read the rest of streamed input into memory. Must be called before splitAtCommands().
+    void readToEnd();
+    // Split the unparsed input into at most `count` chunks, each of which starts at a command
+    // and can be parsed independently. The chunks point into this parser's input.
+    QVector<Chunk> splitAtCommands(int count) const;
 
     bool isOk() const;
     bool atEnd() const;
 
+    qint64 pos() const;
+    qint64 size() const;
+    // The position of the start of the current line, and its number.
+    qint64 linePos() const;
+    int lineNumber() const;
+
     bool atEol();
     void parseEol();
 
-    QString parseRest();
+    QLatin1String parseRest();
 
     bool atCommand();
     void skipToCommand();
-    QString parseCommand();
+    Command parseCommand();
+    QLatin1String commandName() const;
 
     uint parseDecimal();
     uint parseBinary();
 
-    QString parseName();
+    QLatin1String parseName();
+
+    static bool isTileCommand(Command command);
+    static bool isTileBitsCommand(Command command);
+    static QString tileType(Command command);
 
 private:
     QIODevice *_in;
-    QString _line;
+    uchar *_map;
+    QByteArray _data;
+    bool _streaming;
+    qint64 _consumed;
+
+    const char *_begin, *_end;
+    const char *_next;
+    const char *_line, *_lineEnd;
+    const char *_cur;
     int _lineno;
-    int _pos;
     bool _error;
 
+    QLatin1String _command;
+
+    bool readMore(qint64 maxSize);
+    void readNextLine();
     void refill();
-    QRegularExpressionMatch matchRegexp(const QRegularExpression &re);
-    QRegularExpressionMatch matchToken(const QRegularExpression &re);
+    void skipSpaces();
+    void fail(const char *pattern);
+    QLatin1String matchToken(const char *pattern, bool (*first)(char), bool (*rest)(char));
 };
 
 #endif // BLIFPARSER_H
@@ -0,0 +1,181 @@
+#include <QtDebug>
+#include <QFileDevice>
+#include "binparser.h"
+
+static const quint32 PREAMBLE = 0x7eaa997e;
+static const quint16 CRC_POLY = 0x1021;
+static const quint16 CRC_INIT = 0xffff;
+
+BinParser::BinParser(QIODevice *in)
+    : _in(in), _map(nullptr), _crc(CRC_INIT), _payload(0), _error(false)
+{
+    qint64 offset = in->pos();
+    qint64 length = in->size() - offset;
+    if(QFileDevice *file = qobject_cast<QFileDevice *>(in)) {
+        if(length > 0) _map = file->map(offset, length);
+    }
+
+    if(_map) {
+        _begin = _map;
+        _end   = _begin + length;
+    } else {
+        _data  = in->readAll();
+        _begin = reinterpret_cast<const uchar *>(_data.constData());
+        _end   = _begin + _data.size();
+    }
+
+    _cur = _begin;
+    if(!_map && !in->atEnd()) fail("cannot read input");
+}
+
+BinParser::~BinParser()
+{
+    if(_map) {
+        static_cast<QFileDevice *>(_in)->unmap(_map);
+    }
+}
+
+bool BinParser::isBinary(QIODevice *in)
+{
+    // Binary bitstreams start with a comment header (0xff 0x00) or the preamble.
+    QByteArray magic = in->peek(1);
+    return magic.size() == 1 && (uchar(magic[0]) == 0xff || uchar(magic[0]) == PREAMBLE >> 24);
+}
+
+bool BinParser::isOk() const
+{
+    return !_error;
+}
+
+bool BinParser::atEnd() const
+{
+    return _cur == _end;
+}
+
+qint64 BinParser::pos() const
+{
+    return _cur - _begin;
+}
+
+qint64 BinParser::size() const
+{
+    return _end - _begin;
+}
+
+void BinParser::fail(const char *message)
+{
+    if(_error) return;
+
+    _error = true;
+    qCritical() << "at offset" << pos() << QLatin1String(message);
+}
+
+uint BinParser::parseByte()
+{
+    if(_cur == _end) {
+        fail("unexpected end of file");
+        return 0;
+    }
+
+    uint byte = *_cur++;
+    _crc ^= byte << 8;
+    for(int i = 0; i < 8; i++) {
+        _crc = (_crc & 0x8000) ? (_crc << 1) ^ CRC_POLY : _crc << 1;
+    }
+    return byte;
+}
+
+QStringList BinParser::parseHeader()
+{
+    QStringList comment;
+    if(_end - _cur >= 2 && _cur[0] == 0xff && _cur[1] == 0x00) {
+        _cur += 2;
+        const uchar *line = _cur;
+        for(; _cur != _end && !(_cur[0] == 0x00 && _cur + 1 != _end && _cur[1] == 0xff); _cur++) {
+            if(*_cur == 0x00) {
+                comment.append(QString::fromLatin1(reinterpret_cast<const char *>(line),
+                                                   _cur - line));
+                line = _cur + 1;
+            }
+        }
+        if(_cur != line) {
+            comment.append(QString::fromLatin1(reinterpret_cast<const char *>(line),
+                                               _cur - line));
+        }
+    }
+
+    quint32 preamble = 0;
+    while(preamble != PREAMBLE) {
+        if(_cur == _end) {
+            fail("no preamble found");
+            break;
+        }
+        preamble = (preamble << 8) | *_cur++;
+    }
+
+    return comment;
+}
+
+BinParser::Command BinParser::parseCommand()
+{
+    uint opcode  = parseByte();
+    uint length  = opcode & 0x0f;
+    _payload     = 0;
+    for(uint i = 0; i < length; i++) {
+        _payload = (_payload << 8) | parseByte();
+    }
+    if(_error) return Unknown;
+
+    switch(opcode >> 4) {
+    case 0x0:
+        switch(_payload) {
+        case 0x01: return CRAMData;
+        case 0x03: return BRAMData;
+        case 0x05: _crc = CRC_INIT; return ResetCRC;
+        case 0x06: return Wakeup;
+        case 0x08: return Reboot;
+        }
+        break;
+    case 0x1: return Bank;
+    case 0x2:
+        // The CRC is computed over everything after the last reset, including itself.
+        if(_crc != 0) fail("CRC mismatch");
+        return CheckCRC;
+    case 0x5: return FreqRange;
+    case 0x6: _payload += 1; return BankWidth;
+    case 0x7: return BankHeight;
+    case 0x8: return BankOffset;
+    case 0x9: return Flags;
+    }
+
+    fail("unknown command");
+    return Unknown;
+}
+
+uint BinParser::payload() const
+{
+    return _payload;
+}
+
+void BinParser::parseData(int width, int height, QVector<quint64> *words)
+{
+    int count = width * height;
+    if(count % 8 != 0) {
+        fail("data size is not a multiple of 8 bits");
+        return;
+    }
+
+    // The bits are sent most significant first, so each byte is reversed into place.
+    words->fill(0, (count + 63) / 64);
+    for(int i = 0; i < count && !_error; i += 8) {
+        uint byte = parseByte();
+        byte = ((byte & 0xf0) >> 4) | ((byte & 0x0f) << 4);
+        byte = ((byte & 0xcc) >> 2) | ((byte & 0x33) << 2);
+        byte = ((byte & 0xaa) >> 1) | ((byte & 0x55) << 1);
+        (*words)[i >> 6] |= quint64(byte) << (i & 63);
+    }
+
+    if(parseByte() != 0 || parseByte() != 0) {
+        fail("data is not followed by padding");
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef BINPARSER_H
+#define BINPARSER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QStringList>
+#include <QVector>
+
+// A reader for the iCE40 binary configuration format (.bin), as consumed by the device.
+//
+// The input consists of an optional comment header, a preamble, and a sequence of commands,
+// each of which is a byte with an opcode in the high nibble and the length of a big-endian
+// payload in the low nibble. CRAM and BRAM data follow their commands as raw bits, in rows of
+// the current bank width. Like AscParser, the input is memory-mapped when it is a file.
+class BinParser
+{
+public:
+    enum Command {
+        Unknown,
+        CRAMData,
+        BRAMData,
+        ResetCRC,
+        Wakeup,
+        Reboot,
+        Bank,
+        CheckCRC,
+        FreqRange,
+        BankWidth,
+        BankHeight,
+        BankOffset,
+        Flags
+    };
+
+    BinParser(QIODevice *in);
+    ~BinParser();
+
+    // Whether `in` looks like a binary bitstream rather than an ASCII one. Does not consume input.
+    static bool isBinary(QIODevice *in);
+
+    bool isOk() const;
+    bool atEnd() const;
+
+    qint64 pos() const;
+    qint64 size() const;
+
+    // Parse the comment header, if any, and the preamble.
+    QStringList parseHeader();
+    Command parseCommand();
+    // The payload of the last command; for BankWidth, the decoded width.
+    uint payload() const;
+    // Read `width * height` bits of CRAM or BRAM data, row by row, and the padding after them.
+    // Bit `i` of the data is bit `i % 64` of word `i / 64` of `words`, as in PackedBits.
+    void parseData(int width, int height, QVector<quint64> *words);
+
+private:
+    QIODevice *_in;
+    uchar *_map;
+    QByteArray _data;
+
+    const uchar *_begin, *_end;
+    const uchar *_cur;
+    quint16 _crc;
+    uint _payload;
+    bool _error;
+
+    uint parseByte();
+    void fail(const char *message);
+};
+
+#endif // BINPARSER_H
@@ -1,75 +1,500 @@
 #include <QtDebug>
+#include <QAtomicInteger>
+#include <QSet>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <QtConcurrent>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "bitstream.h"
 #include "ascparser.h"
+#include "binparser.h"
+#include "unionfind.h"
 
-Bitstream::Bitstream()
+// The bit of the configuration of a logic cell that enables its FF.
+static const int DFF_ENABLE_BIT = 9;
+// Clocks from the fabric are traced back through at most this many drivers to their source.
+static const int MAX_CLOCK_TRACE = 64;
+
+// The size in tiles, with the IO ring, of the devices that ASCII bitstreams name in their
+// .device line, as in icebox.
+static const struct DeviceSize {
+    const char *device;
+    coord_t width;
+    coord_t height;
+} DEVICE_SIZES[] = {
+    {"384", 8, 10},
+    {"1k", 14, 18},
+    {"lm4k", 26, 22},
+    {"u4k", 26, 32},
+    {"5k", 26, 32},
+    {"8k", 34, 34},
+};
+
+// The CRAM layouts of the devices that binary bitstreams can be loaded for. The CRAM is split
+// into four banks, one per quadrant of the chip; `cramWidth` and `cramHeight` are the size of
+// each bank, and `width` and `height` the size of the chip in tiles without the IO ring.
+// The RAM tiles occupy the columns in `ramColumns`, or none if zero.
+static const struct BinLayout {
+    const char *device;
+    int cramWidth;
+    int cramHeight;
+    coord_t width;
+    coord_t height;
+    coord_t ramColumns[2];
+} BIN_LAYOUTS[] = {
+    {"384", 182, 80, 6, 8, {0, 0}},
+    {"1k", 332, 144, 12, 16, {3, 10}},
+    {"8k", 872, 272, 32, 32, {8, 25}},
+};
+
+// RAM data is written as one line per INIT parameter of the RAM.
+static const int RAM_LINE_BITS = 256;
+
+static const int BIN_BANKS       = 4;
+static const int BIN_TILE_ROWS   = 16;
+static const int BIN_IO_WIDTH    = 18;
+static const int BIN_LOGIC_WIDTH = 54;
+static const int BIN_RAM_WIDTH   = 42;
+
+// The IO tiles at the top and bottom edges are narrower than their column, and their bits are
+// scattered over it.
+static const int BIN_IO_COLUMNS[BIN_IO_WIDTH] = {23, 25, 26, 27, 16, 17, 18, 19, 20,
+                                                 14, 32, 33, 34, 35, 36, 37, 4,  5};
+static const int BIN_IO_ROWS[BIN_TILE_ROWS]    = {0, 1, 3,  2,  4,  5,  7,  6,
+                                                 8, 9, 11, 10, 12, 13, 15, 14};
+
+const QVector<int> Bitstream::LUT_BITS = {4, 14, 15, 5, 6, 16, 17, 7, 3, 13, 12, 2, 1, 11, 10, 0};
+
+Bitstream::Bitstream() : hasRAMData(false), signalCount(0)
 {}
 
 Bitstream::Tile &Bitstream::tile(coord_t x, coord_t y)
 {
-    return tiles[qMakePair(x, y)];
+    return tiles(x, y);
 }
 
-bool Bitstream::parse(QIODevice *in, std::function<void(int, int)> progress)
+const Bitstream::Tile *Bitstream::findTile(coord_t x, coord_t y) const
+{
+    return tiles.find(x, y);
+}
+
+bool Bitstream::parse(QIODevice *in, std::function<bool(int, int)> progress,
+                      std::function<bool(const Tile &)> tileParsed)
+{
+    // Set before any tile is passed to `tileParsed`, and never changed while parsing.
+    hasRAMData = !BinParser::isBinary(in);
+    if(!hasRAMData) {
+        return parseBin(in, progress, tileParsed);
+    } else {
+        return parseAsc(in, progress, tileParsed);
+    }
+}
+
+// ORs the `count` low bits of `value` into `words` from bit `offset` on.
+static inline void appendBits(quint64 *words, int offset, quint64 value, int count)
+{
+    int shift = offset & 63;
+    words[offset >> 6] |= value << shift;
+    if(shift + count > 64) {
+        words[(offset >> 6) + 1] |= value >> (64 - shift);
+    }
+}
+
+// Returns the `count` (at most 64) bits of `words` from bit `offset` on.
+static inline quint64 extractBits(const quint64 *words, int offset, int count)
+{
+    int shift     = offset & 63;
+    quint64 value = words[offset >> 6] >> shift;
+    if(shift + count > 64) {
+        value |= words[(offset >> 6) + 1] << (64 - shift);
+    }
+    return count == 64 ? value : value & ((quint64(1) << count) - 1);
+}
+
+// Reverses the order of the `count` (at least 1) low bits of `value`.
+static inline quint64 reverseBits(quint64 value, int count)
+{
+    value = ((value >> 1) & 0x5555555555555555ull) | ((value & 0x5555555555555555ull) << 1);
+    value = ((value >> 2) & 0x3333333333333333ull) | ((value & 0x3333333333333333ull) << 2);
+    value = ((value >> 4) & 0x0f0f0f0f0f0f0f0full) | ((value & 0x0f0f0f0f0f0f0f0full) << 4);
+    value = ((value >> 8) & 0x00ff00ff00ff00ffull) | ((value & 0x00ff00ff00ff00ffull) << 8);
+    value = ((value >> 16) & 0x0000ffff0000ffffull) | ((value & 0x0000ffff0000ffffull) << 16);
+    value = (value >> 32) | (value << 32);
+    return value >> (64 - count);
+}
+
+// Decodes ASCII '0' and '1' characters into bits set from bit `offset` of `words`, which
+// must be zeroed. Returns the index of the first other character, or -1 if there is none.
+// With SSE2, which every x86-64 CPU has, 16 characters are checked and packed per step. Rows
+// are at most 54 characters, too short for wider vectors to pay off (see tools/loadbench).
+static int decodeAscBits(const char *chars, int count, quint64 *words, int offset)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zeros16 = _mm_set1_epi8('0'), ones16 = _mm_set1_epi8('1');
+    for(; i + 16 <= count; i += 16) {
+        __m128i chunk     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(chars + i));
+        __m128i ones      = _mm_cmpeq_epi8(chunk, ones16);
+        __m128i valid     = _mm_or_si128(ones, _mm_cmpeq_epi8(chunk, zeros16));
+        quint32 validMask = _mm_movemask_epi8(valid);
+        if(validMask != 0xffffu) return i + qCountTrailingZeroBits(~validMask);
+
+        appendBits(words, offset + i, _mm_movemask_epi8(ones), 16);
+    }
+#endif
+    for(; i < count; i++) {
+        if(chars[i] == '1') {
+            appendBits(words, offset + i, 1, 1);
+        } else if(chars[i] != '0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Decodes a line of RAM data, RAM_LINE_BITS bits written as hexadecimal digits with the most
+// significant first, into the words from `words`. Returns the index of a character that is
+// not a hexadecimal digit, or -1 if there is none.
+static int decodeRAMHex(const char *chars, quint64 *words)
+{
+    const int wordCount = RAM_LINE_BITS / 64;
+    for(int word = 0; word < wordCount; word++) {
+        // Each word is written as 16 digits, the lowest word last.
+        int offset    = (wordCount - 1 - word) * 16;
+        quint64 value = 0;
+        for(int i = offset; i < offset + 16; i++) {
+            char c = chars[i];
+            if(c >= '0' && c <= '9') {
+                value = value << 4 | (c - '0');
+            } else if(c >= 'a' && c <= 'f') {
+                value = value << 4 | (c - 'a' + 10);
+            } else if(c >= 'A' && c <= 'F') {
+                value = value << 4 | (c - 'A' + 10);
+            } else {
+                return i;
+            }
+        }
+        words[word] = value;
+    }
+    return -1;
+}
+
+bool Bitstream::parseAsc(QIODevice *in, std::function<bool(int, int)> progress,
+                         std::function<bool(const Tile &)> tileParsed)
 {
     AscParser parser(in);
+    // The bits of the tile being parsed, until its size is known.
+    QVector<quint64> tileWords;
     while(parser.isOk() && !parser.atEnd()) {
-        progress(in->pos(), in->size());
+        if(!progress(parser.pos(), parser.size())) return false;
 
-        QString command = parser.parseCommand();
-        if(command == "comment") {
+        AscParser::Command command = parser.parseCommand();
+        switch(command) {
+        case AscParser::Comment:
             comment = parser.parseRest();
-        } else if(command == "device") {
+            break;
+
+        case AscParser::Device:
             device = parser.parseName();
             parser.parseEol();
-        } else if(command == "io_tile" || command == "logic_tile" || command == "ramb_tile" ||
-                  command == "ramt_tile" || command == "dsp0_tile" || command == "dsp1_tile" ||
-                  command == "dsp2_tile" || command == "dsp3_tile" || command == "ipcon_tile") {
+            // Tiles of other devices grow the grid as they are parsed.
+            for(const DeviceSize &size : DEVICE_SIZES) {
+                if(device == QLatin1String(size.device)) tiles.resize(size.width, size.height);
+            }
+            break;
+
+        case AscParser::IOTile:
+        case AscParser::LogicTile:
+        case AscParser::RAMBTile:
+        case AscParser::RAMTTile:
+        case AscParser::DSP0Tile:
+        case AscParser::DSP1Tile:
+        case AscParser::DSP2Tile:
+        case AscParser::DSP3Tile:
+        case AscParser::IPConTile: {
             Tile tile;
-            tile.type = command.left(command.indexOf("_"));
+            tile.type = AscParser::tileType(command);
             tile.x    = parser.parseDecimal();
             tile.y    = parser.parseDecimal();
             parser.parseEol();
 
+            int bitCount = 0;
+            tileWords.fill(0);
             while(parser.isOk() && !parser.atCommand()) {
-                QString bitsAsc = parser.parseRest();
-                size_t appendAt = tile.bits.count();
-                tile.bits.resize(appendAt + bitsAsc.length());
-                for(QChar bitAsc : bitsAsc) {
-                    if(bitAsc == '0') {
-                        tile.bits.clearBit(appendAt++);
-                    } else if(bitAsc == '1') {
-                        tile.bits.setBit(appendAt++);
-                    } else {
-                        qCritical() << "bit" << appendAt << "not 0 or 1:" << bitAsc;
-                        return false;
-                    }
+                QLatin1String bitsAsc = parser.parseRest();
+                int wordCount         = PackedBits::wordCount(bitCount + bitsAsc.size());
+                if(tileWords.size() < wordCount) tileWords.resize(wordCount);
+
+                int invalid =
+                    decodeAscBits(bitsAsc.data(), bitsAsc.size(), tileWords.data(), bitCount);
+                if(invalid != -1) {
+                    qCritical() << "bit" << bitCount + invalid << "not 0 or 1:"
+                                << QLatin1Char(bitsAsc.data()[invalid]);
+                    return false;
                 }
+                bitCount += bitsAsc.size();
             }
 
-            tiles[qMakePair(tile.x, tile.y)] = tile;
-        } else if(command == "ram_data") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "extra_bit") {
+            int wordCount  = PackedBits::wordCount(bitCount);
+            quint64 *words = bitArena.allocate(wordCount);
+            memcpy(words, tileWords.constData(), wordCount * sizeof(quint64));
+            tile.bits = PackedBits(words, bitCount);
+
+            tiles.insert(tile.x, tile.y, tile);
+            if(tileParsed && !tileParsed(tile)) return false;
+            break;
+        }
+
+        case AscParser::RAMData: {
+            coord_t x = parser.parseDecimal();
+            coord_t y = parser.parseDecimal();
+            parser.parseEol();
+
+            quint64 *words = bitArena.allocate(PackedBits::wordCount(RAM_BITS));
+            int line       = 0;
+            while(parser.isOk() && !parser.atCommand()) {
+                QLatin1String hex = parser.parseRest();
+                if(line == RAM_BITS / RAM_LINE_BITS || hex.size() != RAM_LINE_BITS / 4) {
+                    qCritical() << "invalid RAM data line" << line << "for tile" << x << y;
+                    return false;
+                }
+
+                int invalid = decodeRAMHex(hex.data(), words + line * RAM_LINE_BITS / 64);
+                if(invalid != -1) {
+                    qCritical() << "RAM data digit not hexadecimal:"
+                                << QLatin1Char(hex.data()[invalid]);
+                    return false;
+                }
+                line++;
+            }
+
+            ramData.insert(x, y, PackedBits(words, RAM_BITS));
+            break;
+        }
+
+        case AscParser::ExtraBit:
             // not implemented
             parser.skipToCommand();
-        } else if(command == "sym") {
-            net_t net    = parser.parseDecimal();
-            QString name = parser.parseName();
+            break;
+
+        case AscParser::Sym: {
+            net_t net          = parser.parseDecimal();
+            QLatin1String name = parser.parseName();
+            symbols.add(net, name.data(), name.size());
             parser.parseEol();
+            break;
+        }
 
-            symbols[net] = name;
-        } else {
-            qCritical() << "unexpected command"
-                        << "." + command;
+        default:
+            qCritical() << "unexpected command" << "." + QString(parser.commandName());
             return false;
         }
     }
 
+    symbols.build();
     return parser.isOk();
 }
 
+static bool isRAMColumn(const BinLayout &layout, coord_t x)
+{
+    return x != 0 && (x == layout.ramColumns[0] || x == layout.ramColumns[1]);
+}
+
+static QString binTileType(const BinLayout &layout, coord_t x, coord_t y)
+{
+    bool ioColumn = x == 0 || x == layout.width + 1;
+    bool ioRow    = y == 0 || y == layout.height + 1;
+    if(ioColumn && ioRow) {
+        return QString();
+    } else if(ioColumn || ioRow) {
+        return "io";
+    } else if(isRAMColumn(layout, x)) {
+        return y % 2 == 1 ? "ramb" : "ramt";
+    } else {
+        return "logic";
+    }
+}
+
+static int binColumnWidth(const BinLayout &layout, coord_t x)
+{
+    if(x == 0 || x == layout.width + 1) {
+        return BIN_IO_WIDTH;
+    } else if(isRAMColumn(layout, x)) {
+        return BIN_RAM_WIDTH;
+    } else {
+        return BIN_LOGIC_WIDTH;
+    }
+}
+
+bool Bitstream::parseBin(QIODevice *in, std::function<bool(int, int)> progress,
+                         std::function<bool(const Tile &)> tileParsed)
+{
+    BinParser parser(in);
+    comment = parser.parseHeader().join(' ');
+
+    struct Bank {
+        int width;
+        int height;
+        QVector<quint64> words;
+    } banks[BIN_BANKS] = {};
+
+    uint bank = 0;
+    int width = 0, height = 0, offset = 0;
+    bool wakeup = false;
+    while(parser.isOk() && !wakeup) {
+        if(!progress(parser.pos(), parser.size())) return false;
+
+        switch(parser.parseCommand()) {
+        case BinParser::CRAMData: {
+            if(bank >= BIN_BANKS) {
+                qCritical() << "CRAM bank" << bank << "does not exist";
+                return false;
+            }
+
+            QVector<quint64> words;
+            parser.parseData(width, height, &words);
+            if(!parser.isOk()) return false;
+
+            Bank &cram = banks[bank];
+            if(cram.width != 0 && cram.width != width) {
+                qCritical() << "CRAM bank" << bank << "has inconsistent width" << width;
+                return false;
+            }
+            cram.width  = width;
+            cram.height = qMax(cram.height, offset + height);
+            cram.words.resize(PackedBits::wordCount(cram.width * cram.height));
+            for(int i = 0; i < width * height; i += 64) {
+                int count = qMin(64, width * height - i);
+                appendBits(cram.words.data(), offset * width + i, words[i >> 6], count);
+            }
+            break;
+        }
+
+        case BinParser::BRAMData: {
+            // not implemented; `hasRAMData` stays false
+            QVector<quint64> words;
+            parser.parseData(width, height, &words);
+            break;
+        }
+
+        case BinParser::Wakeup:
+            wakeup = true;
+            break;
+
+        case BinParser::Bank:
+            bank = parser.payload();
+            break;
+
+        case BinParser::BankWidth:
+            width = parser.payload();
+            break;
+
+        case BinParser::BankHeight:
+            height = parser.payload();
+            break;
+
+        case BinParser::BankOffset:
+            offset = parser.payload();
+            break;
+
+        case BinParser::ResetCRC:
+        case BinParser::CheckCRC:
+        case BinParser::FreqRange:
+        case BinParser::Flags:
+        case BinParser::Reboot:
+            break;
+
+        default:
+            return false;
+        }
+    }
+    if(!parser.isOk()) return false;
+
+    // The device is identified by the size of its CRAM banks.
+    const BinLayout *layout = nullptr;
+    for(const BinLayout &candidate : BIN_LAYOUTS) {
+        if(candidate.cramWidth == banks[0].width && candidate.cramHeight == banks[0].height) {
+            layout = &candidate;
+        }
+    }
+    if(!layout) {
+        qCritical() << "unsupported CRAM size" << banks[0].width << "x" << banks[0].height;
+        return false;
+    }
+    for(int i = 1; i < BIN_BANKS; i++) {
+        if(banks[i].width != layout->cramWidth || banks[i].height != layout->cramHeight) {
+            qCritical() << "CRAM bank" << i << "is missing or has the wrong size";
+            return false;
+        }
+    }
+    device = layout->device;
+
+    // Each bank holds a quadrant of the chip, with the columns and rows laid out from the edges
+    // of the chip towards its center; tiles in the right and top halves are mirrored. Each row
+    // of a tile is a run of bits in a row of its bank, except for the IO tiles at the top and
+    // bottom edges, whose bits are scattered over the run of their column.
+    tiles.resize(layout->width + 2, layout->height + 2);
+    for(int y = 0; y <= layout->height + 1; y++) {
+        for(int x = 0; x <= layout->width + 1; x++) {
+            Tile tile;
+            tile.x    = x;
+            tile.y    = y;
+            tile.type = binTileType(*layout, x, y);
+            if(tile.type.isEmpty()) continue;
+
+            bool rightHalf = x > layout->width / 2;
+            bool topHalf   = y > layout->height / 2;
+            bool ioColumn  = x == 0 || x == layout->width + 1;
+            bool ioRow     = !ioColumn && tile.type == "io";
+
+            const Bank &cram = banks[(topHalf ? 1 : 0) | (rightHalf ? 2 : 0)];
+            int bankX        = rightHalf ? layout->width + 1 - x : x;
+            int bankY        = topHalf ? layout->height + 1 - y : y;
+            int columnWidth  = binColumnWidth(*layout, x);
+            int offsetX      = 0;
+            for(int i = 0; i < bankX; i++) {
+                offsetX += binColumnWidth(*layout, rightHalf ? layout->width + 1 - i : i);
+            }
+            int offsetY = bankY * BIN_TILE_ROWS;
+
+            int columns    = ioColumn || ioRow ? BIN_IO_WIDTH : columnWidth;
+            int bitCount   = columns * BIN_TILE_ROWS;
+            quint64 *words = bitArena.allocate(PackedBits::wordCount(bitCount));
+            for(int row = 0; row < BIN_TILE_ROWS; row++) {
+                int cramY;
+                if(ioRow) {
+                    cramY = offsetY + BIN_TILE_ROWS - 1 - BIN_IO_ROWS[row];
+                } else {
+                    cramY = topHalf ? offsetY + BIN_TILE_ROWS - 1 - row : offsetY + row;
+                }
+
+                // Bit `i` of `run` is the `i`th column of the tile, counted from its left edge.
+                quint64 run = extractBits(cram.words.constData(), cramY * cram.width + offsetX,
+                                          columnWidth);
+                if(rightHalf || ioColumn) run = reverseBits(run, columnWidth);
+
+                quint64 value = run;
+                if(ioRow) {
+                    value = 0;
+                    for(int column = 0; column < columns; column++) {
+                        value |= ((run >> BIN_IO_COLUMNS[column]) & 1) << column;
+                    }
+                }
+                appendBits(words, row * columns, value, columns);
+            }
+            tile.bits = PackedBits(words, bitCount);
+
+            tiles.insert(tile.x, tile.y, tile);
+            if(tileParsed && !tileParsed(tile)) return false;
+        }
+    }
+
+    return true;
+}
+
 uint Bitstream::Tile::extract(const QVector<nbit_t> &nbits) const
 {
     uint result = 0;
@@ -80,44 +505,329 @@ uint Bitstream::Tile::extract(const QVector<nbit_t> &nbits) const
     return result;
 }
 
-bool Bitstream::process(ChipDB &chip)
+uint Bitstream::Tile::extract(const ExtractPlan &plan) const
 {
-    netDrivers.fill(-1, chip.nets.length());
-    netLoaded.resize(chip.nets.length());
+    return plan.extract(bits);
+}
 
-    for(Tile &tile : tiles) {
-        if(!chip.tiles.contains(qMakePair(tile.x, tile.y))) {
-            qCritical() << "tile at" << tile.x << tile.y << "does not exist";
-            return false;
+int Bitstream::ramReadWidth(const ChipDB &chip, coord_t x, coord_t y) const
+{
+    const Tile *top = findTile(x, y + 1);
+    if(!top) return 16;
+
+    // The read mode is 0 for 256x16, 1 for 512x8, 2 for 1024x4 and 3 for 2048x2.
+    uint mode = top->extract(chip.functionPlan(top->type, "RamConfig.CBIT_2")) |
+                top->extract(chip.functionPlan(top->type, "RamConfig.CBIT_3")) << 1;
+    return 16 >> mode;
+}
+
+QVector<quint16> Bitstream::decodeRAM(const PackedBits &data, int width)
+{
+    // The RAM is laid out as 256 words of 16 bits. Narrower words are interleaved in them:
+    // word `address` is made of the bits `address >> 8` + `stride` * i of its 16-bit word.
+    int stride = 16 / width;
+    QVector<quint16> words(256 * stride);
+    for(int address = 0; address < words.size(); address++) {
+        int offset = (address & 0xff) * 16 + (address >> 8);
+        for(int i = 0; i < width; i++) {
+            if(data.testBit(offset + i * stride)) words[address] |= 1 << i;
         }
+    }
+    return words;
+}
 
-        if(chip.tile(tile.x, tile.y).type != tile.type) {
-            qCritical() << "tile at" << tile.x << tile.y << "has wrong type" << tile.type;
-            return false;
+TileGrid<uint> Bitstream::extractAll(const QString &type, const ExtractPlan &plan) const
+{
+    TileGrid<uint> values;
+    values.resize(tiles.width(), tiles.height());
+    for(auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if(it->type == type) values.insert(it.x(), it.y(), plan.extract(it->bits));
+    }
+    return values;
+}
+
+QVector<QPoint> Bitstream::changedTiles(const ChipDB &chip, const Bitstream &previous) const
+{
+    QBitArray changed(chip.width * chip.height);
+    for(coord_t x = 0; x < chip.width; x++) {
+        for(coord_t y = 0; y < chip.height; y++) {
+            const Tile *tile         = findTile(x, y);
+            const Tile *previousTile = previous.findTile(x, y);
+            bool differs = tile && previousTile ? tile->bits != previousTile->bits
+                                                : tile != previousTile;
+            differs |= ramData.value(x, y) != previous.ramData.value(x, y);
+            changed.setBit(x * chip.height + y, differs);
         }
+    }
 
-        ChipDB::TileBits &tileBits = chip.tilesBits[tile.type];
-        if(tileBits.rows * tileBits.columns != tile.bits.count()) {
-            qCritical() << "tile at" << tile.x << tile.y << "has wrong bit count"
-                        << tile.bits.count();
-            return false;
+    // The tiles draw their nets from their drivers and loads, so redraw every tile of a net
+    // whose driver or load changed. Both bitstreams were processed for `chip`, so they have
+    // the same nets.
+    for(net_t net = 0; net < netDrivers.size(); net++) {
+        bool same = netDrivers[net] == previous.netDrivers[net] &&
+                    netLoaded[net] == previous.netLoaded[net];
+        if(same) continue;
+
+        for(const ChipDB::NetSegment *segment = chip.netSegmentsBegin(net);
+            segment != chip.netSegmentsEnd(net); segment++) {
+            changed.setBit(segment->tileX * chip.height + segment->tileY);
         }
+    }
 
-        ChipDB::Tile &chipTile = chip.tile(tile.x, tile.y);
-        for(ChipDB::Connection &buffer : chipTile.buffers) {
-            uint config  = tile.extract(buffer.bits);
-            net_t srcNet = buffer.srcNets[config];
-            if(srcNet != (net_t)-1) {
-                if(netDrivers[buffer.dstNet] != (net_t)-1) {
-                    qCritical() << "net" << buffer.dstNet << "is driven by net"
-                                << netDrivers[buffer.dstNet] << "and" << srcNet;
-                    return false;
-                }
-                netDrivers[buffer.dstNet] = srcNet;
-                netLoaded.setBit(srcNet);
+    QVector<QPoint> tiles;
+    for(int index = 0; index < changed.size(); index++) {
+        if(changed[index]) tiles.append(QPoint(index / chip.height, index % chip.height));
+    }
+    return tiles;
+}
+
+bool Bitstream::process(const ChipDB &chip, ChipDB::ParseMode mode)
+{
+    if(mode == ChipDB::ParallelParse && processInParallel(chip)) {
+        endProcess(chip);
+        return true;
+    }
+
+    // Also reached when a parallel run fails, to report the first error in tile order.
+    beginProcess(chip);
+
+    QVector<Driver> drivers;
+    for(const Tile &tile : tiles) {
+        drivers.clear();
+        if(!decodeTile(chip, tile, &drivers) || !addDrivers(drivers)) return false;
+    }
+
+    endProcess(chip);
+    return true;
+}
+
+bool Bitstream::processInParallel(const ChipDB &chip)
+{
+    // Each net is claimed by the first driver found for it with a compare-and-swap, so that a
+    // second one is detected without any locks.
+    QVector<QAtomicInt> drivers(chip.netCount(), QAtomicInt(-1));
+    QVector<QAtomicInteger<quint32>> loaded((chip.netCount() + 31) / 32, 0);
+    QAtomicInt failed(0);
+
+    QVector<const Tile *> tileList;
+    for(const Tile &tile : tiles) {
+        tileList.append(&tile);
+    }
+
+    // Each shard decodes a contiguous range of tiles.
+    int shardCount = QThreadPool::globalInstance()->maxThreadCount();
+    QVector<int> shards;
+    for(int index = 0; index < shardCount; index++) {
+        shards.append(index);
+    }
+
+    QtConcurrent::blockingMap(shards, [&](int shard) {
+        int begin = tileList.size() * shard / shardCount;
+        int end   = tileList.size() * (shard + 1) / shardCount;
+        for(int index = begin; index < end && !failed.load(); index++) {
+            const Tile &tile = *tileList[index];
+            if(!checkTile(chip, tile, false)) {
+                failed.store(1);
+                break;
             }
+
+            bool decoded = forEachDriver(chip, tile, false, [&](const Driver &driver) {
+                if(!drivers[driver.dstNet].testAndSetRelaxed(-1, driver.srcNet)) {
+                    failed.store(1);
+                }
+
+                QAtomicInteger<quint32> &word = loaded[driver.srcNet / 32];
+                quint32 bit                   = 1u << (driver.srcNet % 32);
+                if(!(word.load() & bit)) word.fetchAndOrRelaxed(bit);
+            });
+            if(!decoded) failed.store(1);
         }
+    });
+    // Errors are rare, so the run is repeated serially to find the one a serial run reports,
+    // rather than ordering the errors found by the shards.
+    if(failed.load()) return false;
+
+    netDrivers.resize(chip.netCount());
+    netLoaded.fill(false, chip.netCount());
+    for(net_t net = 0; net < chip.netCount(); net++) {
+        netDrivers[net] = drivers[net].load();
+        if(loaded[net / 32].load() & (1u << (net % 32))) netLoaded.setBit(net);
+    }
+    return true;
+}
+
+void Bitstream::beginProcess(const ChipDB &chip)
+{
+    netDrivers.fill(-1, chip.netCount());
+    netLoaded.fill(false, chip.netCount());
+}
+
+bool Bitstream::checkTile(const ChipDB &chip, const Tile &tile, bool report)
+{
+    const ChipDB::Tile *chipTile = chip.findTile(tile.x, tile.y);
+    if(!chipTile) {
+        if(report) qCritical() << "tile at" << tile.x << tile.y << "does not exist";
+        return false;
+    }
+
+    if(chipTile->type != tile.type) {
+        if(report) qCritical() << "tile at" << tile.x << tile.y << "has wrong type" << tile.type;
+        return false;
+    }
+
+    auto tileBits = chip.tilesBits.constFind(tile.type);
+    if(tileBits == chip.tilesBits.constEnd() ||
+       tileBits->rows * tileBits->columns != tile.bits.size()) {
+        if(report) {
+            qCritical() << "tile at" << tile.x << tile.y << "has wrong bit count"
+                        << tile.bits.size();
+        }
+        return false;
+    }
+
+    return true;
+}
+
+template <class Function>
+bool Bitstream::forEachDriver(const ChipDB &chip, const Tile &tile, bool routing,
+                              Function function)
+{
+    // Most tiles of a sparse design are clear, and need not be decoded.
+    if(tile.bits.isClear() && !chip.drivesWhenClear(tile.x, tile.y)) return true;
+
+    QSharedPointer<const ChipDB::TileConnections> conns = chip.tileConnections(tile.x, tile.y);
+    if(!conns) return false;
+
+    quint32 begin = routing ? conns->buffersCount : 0;
+    quint32 end   = routing ? conns->buffersCount + conns->routingCount : conns->buffersCount;
+    for(quint32 index = begin; index != end; index++) {
+        uint config  = tile.extract(conns->plan(index));
+        net_t srcNet = conns->srcNet(index, config);
+        if(srcNet != (net_t)-1) {
+            function(Driver{conns->connections[index].dstNet, srcNet});
+        }
+    }
+    return true;
+}
+
+bool Bitstream::decodeTile(const ChipDB &chip, const Tile &tile, QVector<Driver> *drivers)
+{
+    if(!checkTile(chip, tile, true)) return false;
+
+    return forEachDriver(chip, tile, false,
+                         [&](const Driver &driver) { drivers->append(driver); });
+}
+
+bool Bitstream::addDrivers(const QVector<Driver> &drivers)
+{
+    for(const Driver &driver : drivers) {
+        if(netDrivers[driver.dstNet] != (net_t)-1) {
+            qCritical() << "net" << driver.dstNet << "is driven by net"
+                        << netDrivers[driver.dstNet] << "and" << driver.srcNet;
+            return false;
+        }
+        netDrivers[driver.dstNet] = driver.srcNet;
+        netLoaded.setBit(driver.srcNet);
     }
 
     return true;
 }
+
+void Bitstream::endProcess(const ChipDB &chip)
+{
+    buildSignals(chip);
+    netGraph.build(netDrivers, netSignals, signalCount);
+    findClockDomains(chip);
+}
+
+void Bitstream::buildSignals(const ChipDB &chip)
+{
+    // Buffers and routing switches that are enabled join the nets on either side into one
+    // signal. The buffers are already decoded into `netDrivers`, so the connections of every
+    // tile are known to decode.
+    UnionFind nets(chip.netCount());
+    for(net_t net = 0; net < netDrivers.size(); net++) {
+        if(netDrivers[net] != -1) nets.unite(net, netDrivers[net]);
+    }
+    for(const Tile &tile : tiles) {
+        forEachDriver(chip, tile, true,
+                      [&](const Driver &driver) { nets.unite(driver.dstNet, driver.srcNet); });
+    }
+
+    // Number the signals in order of their lowest net.
+    signalCount = 0;
+    netSignals.fill(-1, chip.netCount());
+    for(net_t net = 0; net < chip.netCount(); net++) {
+        net_t root = nets.find(net);
+        if(netSignals[root] == -1) netSignals[root] = signalCount++;
+        netSignals[net] = netSignals[root];
+    }
+
+    signalLoaded.fill(false, signalCount);
+    for(net_t net = 0; net < chip.netCount(); net++) {
+        if(netLoaded.testBit(net)) signalLoaded.setBit(netSignals[net]);
+    }
+}
+
+void Bitstream::findClockDomains(const ChipDB &chip)
+{
+    clockDomains.clear();
+
+    // Extract the FF enable bits of the logic cells and the clock polarity of every logic tile
+    // in one pass, as bits 0 to 7 and bit 8 of one value.
+    const ChipDB::TileBits tileBits = chip.tilesBits.value("logic");
+    QVector<nbit_t> negClk          = tileBits.functions.value("NegClk");
+    slot_t clkSlot                  = chip.tileNetSlot("logic", "lutff_global/clk");
+    if(negClk.size() != 1 || clkSlot == -1) return;
+
+    QVector<nbit_t> bits;
+    for(int lc = 0; lc < 8; lc++) {
+        QVector<nbit_t> config = tileBits.functions.value(QString("LC_%1").arg(lc));
+        if(config.size() <= DFF_ENABLE_BIT) return;
+        // The bits of a function are stored most significant first.
+        bits.append(config[config.size() - 1 - DFF_ENABLE_BIT]);
+    }
+    bits.append(negClk[0]);
+    TileGrid<uint> configs = extractAll("logic", ExtractPlan::compile(bits.constData(), 9));
+
+    QHash<QPair<net_t, bool>, int> domainIndexes;
+    QVector<QSet<qint32>> domainColumnBuffers;
+    for(auto config = configs.begin(); config != configs.end(); ++config) {
+        int ffCount = qPopulationCount(*config & 0xff);
+        if(ffCount == 0) continue;
+
+        // Follow the clock to the net that sources it, which is either a global network, or
+        // for a clock from the fabric, the output of the cell generating it. A clock from the
+        // fabric that is put on a global network stops at that network.
+        net_t clock = chip.tileNet(config.x(), config.y(), clkSlot);
+        if(clock != -1) clock = netDrivers[clock];
+        int network = chip.globalNetwork(clock);
+        for(int hops = 0; network == -1 && hops < MAX_CLOCK_TRACE; hops++) {
+            if(clock == -1 || netDrivers[clock] == -1) break;
+            clock   = netDrivers[clock];
+            network = chip.globalNetwork(clock);
+        }
+
+        bool negEdge = *config >> 8 & 1;
+        auto it      = domainIndexes.constFind(qMakePair(clock, negEdge));
+        if(it == domainIndexes.constEnd()) {
+            clockDomains.append(ClockDomain{clock, network, negEdge, 0, 0, 0});
+            domainColumnBuffers.append(QSet<qint32>());
+            it = domainIndexes.insert(qMakePair(clock, negEdge), clockDomains.size() - 1);
+        }
+
+        ClockDomain &domain = clockDomains[*it];
+        domain.ffCount += ffCount;
+        domain.tileCount++;
+        qint32 columnBuffer = chip.tileColumnBuffer(config.x(), config.y());
+        if(columnBuffer != -1) domainColumnBuffers[*it].insert(columnBuffer);
+    }
+    for(int index = 0; index < clockDomains.size(); index++) {
+        clockDomains[index].columnBufferCount = domainColumnBuffers[index].size();
+    }
+
+    std::stable_sort(clockDomains.begin(), clockDomains.end(),
+                     [](const ClockDomain &a, const ClockDomain &b) {
+                         return a.ffCount > b.ffCount;
+                     });
+}
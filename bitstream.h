@@ -6,9 +6,14 @@
 #include <QBitArray>
 #include <QIODevice>
 #include <QMap>
+#include <QPoint>
 #include <QSet>
 #include <QString>
 #include "chipdb.h"
+#include "netgraph.h"
+#include "packedbits.h"
+#include "symbolindex.h"
+#include "tilegrid.h"
 
 class Bitstream
 {
@@ -17,27 +22,127 @@ public:
         coord_t x;
         coord_t y;
         QString type;
-        QBitArray bits;
+        // The bits of a tile with `columns` bits per row, row by row, in `bitArena`.
+        PackedBits bits;
 
         uint extract(const QVector<nbit_t> &nbits) const;
+        uint extract(const ExtractPlan &plan) const;
     };
 
+    struct Driver {
+        net_t dstNet;
+        net_t srcNet;
+    };
+
+    // The FFs clocked by the same edge of the same net, which is -1 if they have no clock.
+    // `network` is the global network carrying the clock, or -1 if it comes from the fabric.
+    struct ClockDomain {
+        net_t clock;
+        int network;
+        bool negEdge;
+        int ffCount;
+        int tileCount;
+        // The distinct column buffers that the tiles of the domain are clocked through.
+        int columnBufferCount;
+    };
+
+    // The number of bits in a block RAM.
+    static const int RAM_BITS = 4096;
+
+    // The bits of the configuration of a logic cell that make up its LUT truth table: for any
+    // binary digits ABCD, LUT[ABCD] is bit LUT_BITS[0bABCD] of the configuration.
+    static const QVector<int> LUT_BITS;
+
     Bitstream();
-    bool parse(QIODevice *in, std::function<void(int, int)> progress);
-    bool process(ChipDB &chip);
+    // Parse either an IceStorm ASCII bitstream or an iCE40 binary one, which is detected
+    // from its first byte. Parsing is cancelled if `progress` returns false. If `tileParsed`
+    // is given, it is called with every tile as soon as it is parsed, and parsing stops if it
+    // returns false.
+    bool parse(QIODevice *in, std::function<bool(int, int)> progress,
+               std::function<bool(const Tile &)> tileParsed = nullptr);
+    bool parseAsc(QIODevice *in, std::function<bool(int, int)> progress,
+                  std::function<bool(const Tile &)> tileParsed = nullptr);
+    bool parseBin(QIODevice *in, std::function<bool(int, int)> progress,
+                  std::function<bool(const Tile &)> tileParsed = nullptr);
+    // Find the driver of every net configured by the tiles. With ParallelParse, the tiles are
+    // decoded by the global thread pool; any error reported is the one a serial run reports.
+    bool process(const ChipDB &chip, ChipDB::ParseMode mode = ChipDB::SerialParse);
 
+    // The steps of process(), for processing tiles one by one as they arrive. decodeTile()
+    // only reads the chipdb, so it can run in any thread.
+    void beginProcess(const ChipDB &chip);
+    static bool decodeTile(const ChipDB &chip, const Tile &tile, QVector<Driver> *drivers);
+    bool addDrivers(const QVector<Driver> &drivers);
+    // Build the signals, the net graph and the clock domains, once the drivers of all tiles
+    // are added.
+    void endProcess(const ChipDB &chip);
+    // Find the signal of every net from the enabled buffers and routing switches. Must be
+    // called once the drivers of all tiles are added.
+    void buildSignals(const ChipDB &chip);
+    // Group the FFs of all logic tiles into `clockDomains`, largest first. Must be called
+    // once the drivers of all tiles are added.
+    void findClockDomains(const ChipDB &chip);
+
+    // The width of the words read from the block RAM whose bottom tile is at (x, y), as
+    // configured by the RamConfig.CBIT_2 and CBIT_3 bits of its top tile, which icebox_vlog
+    // reads as READ_MODE: 16, 8, 4 or 2 bits.
+    int ramReadWidth(const ChipDB &chip, coord_t x, coord_t y) const;
+    // Decode the contents of a block RAM into its words of `width` bits, in address order.
+    static QVector<quint16> decodeRAM(const PackedBits &data, int width);
+
+    // Extract `plan` from every tile of type `type`, in a single pass over the tiles.
+    TileGrid<uint> extractAll(const QString &type, const ExtractPlan &plan) const;
+
+    // The tiles whose floorplan may differ from that of `previous`, a processed bitstream for
+    // the same chipdb: those whose bits differ, and those with a net whose driver or load
+    // differs. Must be called once both are processed.
+    QVector<QPoint> changedTiles(const ChipDB &chip, const Bitstream &previous) const;
+
+    // Returns the tile at (x, y), adding it if there is none.
     Tile &tile(coord_t x, coord_t y);
+    // Never modifies the bitstream, and is safe to call from any thread.
+    const Tile *findTile(coord_t x, coord_t y) const;
 
     QString comment;
     QString device;
-    QMap<QPair<coord_t, coord_t>, Tile> tiles;
-    QMap<net_t, QString> symbols;
+    TileGrid<Tile> tiles;
+    BitArena bitArena;
+    // The initial contents of the block RAMs that have any, RAM_BITS each in `bitArena`, keyed
+    // by the coordinates of their bottom tile. Bit `i` of a RAM is bit `i % 256` of its
+    // INIT_`i / 256` parameter.
+    TileGrid<PackedBits> ramData;
+    // Whether `ramData` was read at all: the BRAM banks of binary bitstreams are skipped. Set
+    // by parse() before the first tile is parsed.
+    bool hasRAMData;
+    // The names of the nets, from the .sym lines of an ASCII bitstream.
+    SymbolIndex symbols;
 
     QMap<QPair<Tile *, QString>, net_t> tileNets;
     QVector<net_t> netDrivers;
+    // Whether a buffer reads the net itself; see `signalLoaded` for loads through routing.
     QBitArray netLoaded;
+
+    // The nets connected by buffers and routing switches form one logical signal. Signals
+    // are numbered from 0 up to `signalCount`, in order of their lowest net.
+    QVector<qint32> netSignals;
+    int signalCount;
+    // Whether a buffer reads any of the nets of the signal.
+    QBitArray signalLoaded;
+    NetGraph netGraph;
+    QVector<ClockDomain> clockDomains;
+
+private:
+    bool processInParallel(const ChipDB &chip);
+    // Returns whether `tile` matches the tile at its position in the chipdb, and reports why
+    // not if `report` is set. forEachDriver() may only be called for tiles that match, and
+    // calls `function` with the nets joined by its buffers, or by its routing switches. It
+    // returns false if the connections of the tile cannot be decoded.
+    static bool checkTile(const ChipDB &chip, const Tile &tile, bool report);
+    template <class Function>
+    static bool forEachDriver(const ChipDB &chip, const Tile &tile, bool routing,
+                              Function function);
 };
 
-Q_DECLARE_METATYPE(Bitstream)
+Q_DECLARE_METATYPE(QSharedPointer<const Bitstream>)
 
 #endif // BITSTREAM_H
@@ -0,0 +1,127 @@
+#include <QtDebug>
+#include <QtAlgorithms>
+#include "bitstreamdiff.h"
+
+// The bit of the configuration of a logic cell that enables its carry.
+static const int CARRY_ENABLE_BIT = 8;
+
+int BitstreamDiff::Tile::changeCount(ChangeKind kind) const
+{
+    int count = 0;
+    for(const Change &change : changes) {
+        if(change.kind == kind) count++;
+    }
+    return count;
+}
+
+static int differentBits(const PackedBits &a, const PackedBits &b)
+{
+    int count = 0;
+    for(int index = 0; index < PackedBits::wordCount(a.size()); index++) {
+        count += qPopulationCount(a.words()[index] ^ b.words()[index]);
+    }
+    return count;
+}
+
+static void diffConnections(const ChipDB::TileConnections &conns, quint32 begin, quint32 end,
+                            BitstreamDiff::ChangeKind kind, const PackedBits &oldBits,
+                            const PackedBits &newBits, QVector<BitstreamDiff::Change> *changes)
+{
+    for(quint32 index = begin; index != end; index++) {
+        const ExtractPlan &plan = conns.plan(index);
+        uint oldConfig          = plan.extract(oldBits);
+        uint newConfig          = plan.extract(newBits);
+        if(oldConfig == newConfig) continue;
+
+        net_t oldNet = conns.srcNet(index, oldConfig), newNet = conns.srcNet(index, newConfig);
+        if(oldNet != newNet) {
+            changes->append(BitstreamDiff::Change{kind, index, oldNet, newNet});
+        }
+    }
+}
+
+bool BitstreamDiff::compare(const ChipDB &chip, const Bitstream &oldBitstream,
+                            const Bitstream &newBitstream)
+{
+    tiles.clear();
+    if(oldBitstream.device != newBitstream.device) {
+        qCritical() << "cannot compare bitstreams for" << oldBitstream.device << "and"
+                    << newBitstream.device;
+        return false;
+    }
+
+    // Tiles missing from one bitstream are compared with all-zero bits.
+    int maxBitCount = 0;
+    for(const ChipDB::TileBits &tileBits : chip.tilesBits) {
+        maxBitCount = qMax(maxBitCount, tileBits.columns * tileBits.rows);
+    }
+    QVector<quint64> zeros(PackedBits::wordCount(maxBitCount), 0);
+
+    // Resolve the plans of the logic cells once.
+    uint lutMask = 0;
+    for(int bit : Bitstream::LUT_BITS) {
+        lutMask |= 1u << bit;
+    }
+    const ChipDB::TileBits logicBits = chip.tilesBits.value("logic");
+    ExtractPlan configPlans[8], lutPlans[8];
+    for(int lc = 0; lc < 8; lc++) {
+        QVector<nbit_t> config = logicBits.functions.value(QString("LC_%1").arg(lc));
+        configPlans[lc]        = ExtractPlan::fromFunction(config);
+        lutPlans[lc]           = ExtractPlan::fromFunction(config, Bitstream::LUT_BITS);
+    }
+
+    for(const ChipDB::Tile &chipTile : chip.tiles) {
+        const Bitstream::Tile *oldTile = oldBitstream.findTile(chipTile.x, chipTile.y);
+        const Bitstream::Tile *newTile = newBitstream.findTile(chipTile.x, chipTile.y);
+        if(!oldTile && !newTile) continue;
+
+        int bitCount       = (oldTile ? oldTile : newTile)->bits.size();
+        PackedBits oldBits = oldTile ? oldTile->bits : PackedBits(zeros.constData(), bitCount);
+        PackedBits newBits = newTile ? newTile->bits : PackedBits(zeros.constData(), bitCount);
+        if(oldBits.size() != newBits.size()) continue;
+
+        Tile tile{chipTile.x, chipTile.y, chipTile.type, differentBits(oldBits, newBits), {}};
+        if(tile.bitCount == 0) continue;
+
+        QSharedPointer<const ChipDB::TileConnections> conns =
+            chip.tileConnections(chipTile.x, chipTile.y);
+        if(!conns) return false;
+
+        quint32 connCount = conns->buffersCount + conns->routingCount;
+        diffConnections(*conns, 0, conns->buffersCount, BufferChange, oldBits, newBits,
+                        &tile.changes);
+        diffConnections(*conns, conns->buffersCount, connCount, RoutingChange, oldBits, newBits,
+                        &tile.changes);
+
+        if(chipTile.type == "logic") {
+            for(int lc = 0; lc < 8; lc++) {
+                uint oldLUT = lutPlans[lc].extract(oldBits);
+                uint newLUT = lutPlans[lc].extract(newBits);
+                if(oldLUT != newLUT) {
+                    tile.changes.append(Change{LUTChange, quint32(lc), qint32(oldLUT),
+                                               qint32(newLUT)});
+                }
+
+                uint oldConfig = configPlans[lc].extract(oldBits);
+                uint newConfig = configPlans[lc].extract(newBits);
+                uint oldFF     = oldConfig & ~lutMask & ~(1u << CARRY_ENABLE_BIT);
+                uint newFF     = newConfig & ~lutMask & ~(1u << CARRY_ENABLE_BIT);
+                if(oldFF != newFF) {
+                    tile.changes.append(Change{FFChange, quint32(lc), qint32(oldFF),
+                                               qint32(newFF)});
+                }
+
+                uint oldCarry = (oldConfig >> CARRY_ENABLE_BIT) & 1;
+                uint newCarry = (newConfig >> CARRY_ENABLE_BIT) & 1;
+                if(oldCarry != newCarry) {
+                    tile.changes.append(Change{CarryChange, quint32(lc), qint32(oldCarry),
+                                               qint32(newCarry)});
+                }
+            }
+        }
+
+        tiles.append(tile);
+    }
+
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef BITSTREAMDIFF_H
+#define BITSTREAMDIFF_H
+
+#include <QSharedPointer>
+#include <QVector>
+#include "bitstream.h"
+#include "chipdb.h"
+
+// The differences between two bitstreams for the same device, which need not be processed.
+// Tiles are compared word by word, and only those that differ are decoded to find what
+// changed in them.
+class BitstreamDiff
+{
+public:
+    enum ChangeKind { LUTChange, FFChange, CarryChange, BufferChange, RoutingChange };
+
+    // For LUTs, `index` is the logic cell and the values are its truth tables. For FFs, it is
+    // the logic cell and the values are the FF configuration: enable and set/reset mode. For
+    // carries, it is the logic cell and the values are its carry enable. For buffers and
+    // routing switches, it is the connection within the tile and the values are the source
+    // nets, which are -1 if there is none.
+    struct Change {
+        ChangeKind kind;
+        quint32 index;
+        qint32 oldValue;
+        qint32 newValue;
+    };
+
+    // A tile whose bits differ in `bitCount` places, which is in only one of the bitstreams
+    // if it is missing from the other.
+    struct Tile {
+        coord_t x;
+        coord_t y;
+        QString type;
+        int bitCount;
+        QVector<Change> changes;
+
+        int changeCount(ChangeKind kind) const;
+    };
+
+    // Returns false if the bitstreams are for different devices, or if the connections of a
+    // tile that differs cannot be decoded.
+    bool compare(const ChipDB &chip, const Bitstream &oldBitstream,
+                 const Bitstream &newBitstream);
+
+    QVector<Tile> tiles;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<const BitstreamDiff>)
+
+#endif // BITSTREAMDIFF_H
@@ -0,0 +1,50 @@
+#include <QtDebug>
+#include <QFile>
+#include "bitstreamfileloader.h"
+#include "gzipdevice.h"
+
+BitstreamFileLoader::BitstreamFileLoader(QObject *parent, QString filename,
+                                         QSharedPointer<const ChipDB> chipDB,
+                                         QSharedPointer<const Bitstream> bitstream)
+    : QThread(parent), _filename(filename), _chipDB(chipDB), _bitstream(bitstream)
+{}
+
+const LoadProgress &BitstreamFileLoader::progress() const
+{
+    return _progress;
+}
+
+void BitstreamFileLoader::abort()
+{
+    _progress.cancel();
+}
+
+QSharedPointer<Bitstream> BitstreamFileLoader::loadBitstream()
+{
+    QFile file(_filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "cannot open" << _filename << file.errorString();
+        return QSharedPointer<Bitstream>();
+    }
+
+    GzipDevice gzip(&file);
+    QIODevice *in = &file;
+    if(GzipDevice::isCompressed(&file)) {
+        gzip.open(QIODevice::ReadOnly);
+        in = &gzip;
+    }
+
+    QSharedPointer<Bitstream> bitstream(new Bitstream);
+    bool ok = bitstream->parse(in, [&](int cur, int max) {
+        return in == &gzip ? _progress.update(file.pos(), file.size())
+                           : _progress.update(cur, max);
+    });
+    if(!ok || _progress.isCancelled()) return QSharedPointer<Bitstream>();
+
+    if(bitstream->device != _bitstream->device) {
+        qCritical() << _filename << "is for" << bitstream->device << "instead of"
+                    << _bitstream->device;
+        return QSharedPointer<Bitstream>();
+    }
+    return bitstream;
+}
@@ -0,0 +1,38 @@
+#ifndef BITSTREAMFILELOADER_H
+#define BITSTREAMFILELOADER_H
+
+#include <QThread>
+#include <QString>
+#include "bitstream.h"
+#include "chipdb.h"
+#include "loadprogress.h"
+
+// Base of the loaders that load a second bitstream from a file and relate it to `bitstream`,
+// which is already shown. Subclasses implement run() on top of loadBitstream().
+class BitstreamFileLoader : public QThread
+{
+    Q_OBJECT
+public:
+    BitstreamFileLoader(QObject *parent, QString filename, QSharedPointer<const ChipDB> chipDB,
+                        QSharedPointer<const Bitstream> bitstream);
+
+    const LoadProgress &progress() const;
+    // Stop loading as soon as possible. Neither ready() nor failed() are emitted afterwards.
+    void abort();
+
+protected:
+    QString _filename;
+    QSharedPointer<const ChipDB> _chipDB;
+    QSharedPointer<const Bitstream> _bitstream;
+    LoadProgress _progress;
+
+    // Open `_filename`, decompressing it if needed, and parse it with progress. Returns null if
+    // that fails, if the file is for another device than `_bitstream`, or if the load was
+    // aborted, which the caller tells apart by `_progress.isCancelled()`.
+    QSharedPointer<Bitstream> loadBitstream();
+
+signals:
+    void failed();
+};
+
+#endif // BITSTREAMFILELOADER_H
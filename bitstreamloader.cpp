@@ -1,19 +1,239 @@
 #include <QFile>
 #include "bitstreamloader.h"
+#include "gzipdevice.h"
+
+static const int PARSED_TILES_CAPACITY  = 64;
+static const int DECODED_TILES_CAPACITY = 64;
+static const int TILES_PER_BATCH        = 16;
+
+namespace
+{
+class Stage : public QThread
+{
+public:
+    Stage(std::function<void()> body) : _body(body)
+    {}
+
+private:
+    std::function<void()> _body;
+
+    void run() override
+    {
+        _body();
+    }
+};
+}
 
 BitstreamLoader::BitstreamLoader(QObject *parent, QString filename)
-    : QThread(parent), _filename(filename)
+    : QThread(parent), _filename(filename), _bitstream(new Bitstream), _building(false),
+      _stopped(false), _aborted(false), _lutNotation(FloorplanBuilder::RawLUTs),
+      _showUnusedLogic(false), _failed(0), _parsedTiles(PARSED_TILES_CAPACITY),
+      _decodedTiles(DECODED_TILES_CAPACITY), _decoder(new Stage([this] { decode(); })),
+      _builder(new Stage([this] { build(); }))
 {}
 
+BitstreamLoader::~BitstreamLoader()
+{
+    abort();
+    wait();
+    _decoder->wait();
+    _builder->wait();
+
+    delete _decoder;
+    delete _builder;
+}
+
+void BitstreamLoader::startBuilding(QSharedPointer<const ChipDB> chipDB,
+                                    FloorplanBuilder::LUTNotation lutNotation,
+                                    bool showUnusedLogic)
+{
+    QMutexLocker locker(&_mutex);
+    if(_building || _stopped) return;
+
+    _chipDB          = chipDB;
+    _lutNotation     = lutNotation;
+    _showUnusedLogic = showUnusedLogic;
+    _bitstream->beginProcess(*chipDB);
+
+    _building = true;
+    _decoder->start();
+    _builder->start();
+    _stateChanged.wakeAll();
+}
+
+void BitstreamLoader::abort()
+{
+    QMutexLocker locker(&_mutex);
+    _aborted = true;
+    locker.unlock();
+
+    _progress.cancel();
+    stop();
+}
+
+const LoadProgress &BitstreamLoader::progress() const
+{
+    return _progress;
+}
+
+void BitstreamLoader::stop()
+{
+    QMutexLocker locker(&_mutex);
+    _stopped = true;
+    _parsedTiles.abort();
+    _decodedTiles.abort();
+    _stateChanged.wakeAll();
+}
+
 void BitstreamLoader::run()
 {
     QFile file(_filename);
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
+    file.open(QIODevice::ReadOnly);
+
+    // Compressed input is decompressed as it is parsed, and progress is reported against
+    // the compressed size, since the uncompressed one is not known in advance.
+    GzipDevice gzip(&file);
+    QIODevice *in = &file;
+    if(GzipDevice::isCompressed(&file)) {
+        gzip.open(QIODevice::ReadOnly);
+        in = &gzip;
+    }
+
+    // The device is declared before the first tile, and is needed to start decoding them.
+    bool deviceReported = false;
+    auto reportDevice   = [&] {
+        if(!deviceReported) {
+            deviceReported = true;
+            emit deviceFound(_bitstream->device);
+        }
+    };
 
-    Bitstream bitstream;
-    if(bitstream.parse(&file, [=](int cur, int max) { emit progress(cur, max); })) {
-        emit ready(bitstream);
+    auto reportProgress = [&](int cur, int max) {
+        if(in == &gzip) {
+            return _progress.update(file.pos(), file.size());
+        } else {
+            return _progress.update(cur, max);
+        }
+    };
+    bool ok = _bitstream->parse(in, reportProgress,
+                               [&](const Bitstream::Tile &tile) {
+                                   reportDevice();
+                                   return _parsedTiles.push(tile);
+                               });
+    _parsedTiles.close();
+    if(ok) {
+        reportDevice();
     } else {
+        stop();
+    }
+
+    QMutexLocker locker(&_mutex);
+    while(!_building && !_stopped) {
+        _stateChanged.wait(&_mutex);
+    }
+    bool building = _building;
+    locker.unlock();
+
+    if(building) {
+        _decoder->wait();
+        _builder->wait();
+    }
+
+    locker.relock();
+    if(_aborted) return;
+    locker.unlock();
+
+    if(_failed.load()) {
+        emit invalid(_bitstream->comment);
+    } else if(!ok) {
         emit failed();
+    } else {
+        _bitstream->endProcess(*_chipDB);
+        emit ready(_bitstream);
+    }
+}
+
+void BitstreamLoader::decode()
+{
+    Bitstream::Tile tile;
+    while(_parsedTiles.pop(&tile)) {
+        DecodedTile decoded{tile, true, {}};
+        decoded.ok = Bitstream::decodeTile(*_chipDB, tile, &decoded.drivers);
+        if(!_decodedTiles.push(decoded)) return;
+    }
+
+    _decodedTiles.close();
+}
+
+void BitstreamLoader::build()
+{
+    FloorplanBuilder builder(_chipDB.data(), _bitstream.data(), nullptr, _lutNotation,
+                             _showUnusedLogic);
+
+    // A tile is drawn according to the drivers and loads of some of its nets, which are
+    // configured by the tiles these nets run through; so it is drawn once all of those are
+    // decoded. A tile that cannot be drawn yet waits on the first of them that is not decoded,
+    // and is checked again once that one is.
+    // The contents of the RAMs follow the tiles, and are added to the bitstream while it is
+    // parsed, so RAM tiles, which look them up, are only drawn once parsing is done.
+    TileGrid<bool> decodedTiles;
+    TileGrid<Bitstream::Tile> pendingTiles;
+    TileGrid<QVector<QPoint>> waitingTiles;
+    decodedTiles.resize(_chipDB->tiles.width(), _chipDB->tiles.height());
+    pendingTiles.resize(_chipDB->tiles.width(), _chipDB->tiles.height());
+    waitingTiles.resize(_chipDB->tiles.width(), _chipDB->tiles.height());
+
+    QVector<FloorplanBuilder::TileDrawing> drawings;
+    auto tryDraw = [&](coord_t x, coord_t y) {
+        const Bitstream::Tile *pending = pendingTiles.find(x, y);
+        if(!pending || pending->type == "ramb" || pending->type == "ramt") return;
+
+        for(net_t net : builder.drawnNets(x, y)) {
+            for(const ChipDB::NetSegment *segment = _chipDB->netSegmentsBegin(net);
+                segment != _chipDB->netSegmentsEnd(net); segment++) {
+                if(!decodedTiles.contains(segment->tileX, segment->tileY)) {
+                    waitingTiles(segment->tileX, segment->tileY).append(QPoint(x, y));
+                    return;
+                }
+            }
+        }
+        drawings.append(builder.drawTile(pendingTiles.take(x, y)));
+    };
+
+    DecodedTile decoded;
+    while(_decodedTiles.pop(&decoded)) {
+        if(!decoded.ok || !_bitstream->addDrivers(decoded.drivers)) {
+            _failed.store(1);
+            stop();
+            break;
+        }
+
+        const Bitstream::Tile &tile = decoded.tile;
+        decodedTiles.insert(tile.x, tile.y, true);
+        pendingTiles.insert(tile.x, tile.y, tile);
+
+        tryDraw(tile.x, tile.y);
+        for(const QPoint &waiting : waitingTiles.take(tile.x, tile.y)) {
+            tryDraw(waiting.x(), waiting.y());
+        }
+
+        if(drawings.size() >= TILES_PER_BATCH) {
+            emit tilesDrawn(drawings);
+            drawings.clear();
+        }
+    }
+
+    QMutexLocker locker(&_mutex);
+    if(_stopped) return;
+    locker.unlock();
+
+    // Tiles whose nets run through tiles missing from the bitstream, and RAM tiles.
+    // No tiles are left to decode, so parsing is done.
+    for(const Bitstream::Tile &tile : pendingTiles) {
+        drawings.append(builder.drawTile(tile));
+    }
+
+    if(!drawings.isEmpty()) {
+        emit tilesDrawn(drawings);
     }
 }
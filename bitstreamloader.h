@@ -1,24 +1,74 @@
 #ifndef BITSTREAMLOADER_H
 #define BITSTREAMLOADER_H
 
+#include <QMutex>
 #include <QThread>
 #include <QString>
+#include <QVector>
+#include <QWaitCondition>
 #include "bitstream.h"
+#include "boundedqueue.h"
+#include "floorplanbuilder.h"
+#include "loadprogress.h"
 
+// Loads a bitstream and builds its floorplan in a pipeline of three threads: this one parses
+// tiles, the decoder finds the net drivers configured by each tile, and the builder draws
+// each tile once the tiles its nets run through are decoded. The drawings are plain data,
+// whose items are created on the GUI thread. The stages are connected by bounded queues, so
+// parsing waits for the chipdb (see startBuilding()) once they fill up.
 class BitstreamLoader : public QThread
 {
     Q_OBJECT
 public:
     BitstreamLoader(QObject *parent, QString filename);
+    ~BitstreamLoader();
+
+    // Start decoding and building tiles. Must be called once `chipDB`, for the device
+    // reported by deviceFound(), is available.
+    void startBuilding(QSharedPointer<const ChipDB> chipDB,
+                       FloorplanBuilder::LUTNotation lutNotation, bool showUnusedLogic);
+    // Stop every stage as soon as possible. No further signals are emitted.
+    void abort();
+
+    const LoadProgress &progress() const;
 
 private:
+    struct DecodedTile {
+        Bitstream::Tile tile;
+        bool ok;
+        QVector<Bitstream::Driver> drivers;
+    };
+
     QString _filename;
+    // Only this loader's threads modify the bitstream, and only until it is passed to ready().
+    QSharedPointer<Bitstream> _bitstream;
+
+    QMutex _mutex;
+    QWaitCondition _stateChanged;
+    bool _building;
+    bool _stopped;
+    bool _aborted;
+    QSharedPointer<const ChipDB> _chipDB;
+    FloorplanBuilder::LUTNotation _lutNotation;
+    bool _showUnusedLogic;
+    QAtomicInt _failed;
+    LoadProgress _progress;
+
+    BoundedQueue<Bitstream::Tile> _parsedTiles;
+    BoundedQueue<DecodedTile> _decodedTiles;
+    QThread *_decoder;
+    QThread *_builder;
 
     void run() override;
+    void decode();
+    void build();
+    void stop();
 
 signals:
-    void progress(int cur, int max);
-    void ready(Bitstream bitstream);
+    void deviceFound(QString device);
+    void tilesDrawn(QVector<FloorplanBuilder::TileDrawing> drawings);
+    void ready(QSharedPointer<const Bitstream> bitstream);
+    void invalid(QString comment);
     void failed();
 };
 
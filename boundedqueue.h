@@ -0,0 +1,74 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+
+// A queue for handing items from one thread to another, which blocks the producer while it is
+// full and the consumer while it is empty.
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity) : _capacity(capacity), _closed(false), _aborted(false)
+    {}
+
+    // Returns false if the queue was aborted, in which case the item is dropped.
+    bool push(const T &item)
+    {
+        QMutexLocker locker(&_mutex);
+        while(_queue.size() >= _capacity && !_aborted) {
+            _notFull.wait(&_mutex);
+        }
+        if(_aborted) return false;
+
+        _queue.enqueue(item);
+        _notEmpty.wakeOne();
+        return true;
+    }
+
+    // Returns false once the queue was closed and every item was popped, or it was aborted.
+    bool pop(T *item)
+    {
+        QMutexLocker locker(&_mutex);
+        while(_queue.isEmpty() && !_closed && !_aborted) {
+            _notEmpty.wait(&_mutex);
+        }
+        if(_aborted || _queue.isEmpty()) return false;
+
+        *item = _queue.dequeue();
+        _notFull.wakeOne();
+        return true;
+    }
+
+    // Signal the consumer that no more items will be pushed.
+    void close()
+    {
+        QMutexLocker locker(&_mutex);
+        _closed = true;
+        _notEmpty.wakeAll();
+    }
+
+    // Drop every item and release both the producer and the consumer.
+    void abort()
+    {
+        QMutexLocker locker(&_mutex);
+        _aborted = true;
+        _queue.clear();
+        _notEmpty.wakeAll();
+        _notFull.wakeAll();
+    }
+
+private:
+    int _capacity;
+    bool _closed;
+    bool _aborted;
+
+    QMutex _mutex;
+    QWaitCondition _notEmpty;
+    QWaitCondition _notFull;
+    QQueue<T> _queue;
+};
+
+#endif // BOUNDEDQUEUE_H
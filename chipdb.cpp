@@ -1,68 +1,440 @@
 #include <QtDebug>
-#include <QRegularExpression>
+#include <QFile>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <limits>
 #include "chipdb.h"
 #include "ascparser.h"
 
+static const qint64 DEFAULT_CONNECTION_CACHE_BUDGET = 64 << 20;
+
+ChipDB::NetTables::NetTables()
+    : netCount(0), offsets(nullptr), segments(nullptr), tileOffsets(nullptr), tileNets(nullptr)
+{}
+
 ChipDB::ChipDB() : width(0), height(0)
 {}
 
 ChipDB::Tile &ChipDB::tile(coord_t x, coord_t y)
 {
-    return tiles[qMakePair(x, y)];
+    return tiles(x, y);
+}
+
+const ChipDB::Tile *ChipDB::findTile(coord_t x, coord_t y) const
+{
+    return tiles.find(x, y);
+}
+
+slot_t ChipDB::tileNetSlot(const QString &type, const QString &name) const
+{
+    auto it = tileNetSlots.find(type);
+    return it != tileNetSlots.end() ? it->slotOf.value(name, -1) : -1;
+}
+
+net_t ChipDB::tileNet(coord_t x, coord_t y, slot_t slot) const
+{
+    if(!netTables.tileOffsets || x >= width || y >= height || slot < 0) return -1;
+
+    int index     = x * height + y;
+    quint32 entry = netTables.tileOffsets[index] + slot;
+    return entry < netTables.tileOffsets[index + 1] ? netTables.tileNets[entry] : -1;
+}
+
+net_t ChipDB::tileNet(coord_t x, coord_t y, const QString &name) const
+{
+    const Tile *tile = findTile(x, y);
+    return tile ? tileNet(x, y, tileNetSlot(tile->type, name)) : -1;
+}
+
+QString ChipDB::tileNetName(coord_t x, coord_t y, slot_t slot) const
+{
+    const Tile *tile = findTile(x, y);
+    return tile ? tileNetSlots.value(tile->type).names.value(slot) : QString();
+}
+
+int ChipDB::netCount() const
+{
+    return netTables.netCount;
+}
+
+const ChipDB::NetSegment *ChipDB::netSegmentsBegin(net_t net) const
+{
+    return netTables.segments + netTables.offsets[net];
+}
+
+const ChipDB::NetSegment *ChipDB::netSegmentsEnd(net_t net) const
+{
+    return netTables.segments + netTables.offsets[net + 1];
+}
+
+int ChipDB::globalNetwork(net_t net) const
+{
+    for(int network = 0; network < globalNetworks.size(); network++) {
+        if(net != -1 && globalNetworks[network].net == net) return network;
+    }
+    return -1;
+}
+
+int ChipDB::tileColumnBuffer(coord_t x, coord_t y) const
+{
+    return tileColumnBuffers.value(x, y, -1);
+}
+
+const ExtractPlan &ChipDB::functionPlan(const QString &type, const QString &name) const
+{
+    static const ExtractPlan NO_PLAN;
+
+    auto tileBits = tilesBits.constFind(type);
+    if(tileBits == tilesBits.constEnd()) return NO_PLAN;
+
+    auto plan = tileBits->functionPlans.constFind(name);
+    return plan != tileBits->functionPlans.constEnd() ? *plan : NO_PLAN;
+}
+
+QSharedPointer<const ChipDB::TileConnections> ChipDB::tileConnections(coord_t x, coord_t y) const
+{
+    if(!connectionSource) return nullptr;
+    return connectionSource->tileConnections(*this, x, y);
+}
+
+bool ChipDB::drivesWhenClear(coord_t x, coord_t y) const
+{
+    return connectionSource && connectionSource->drivesWhenClear(*this, x, y);
+}
+
+void ChipDB::TileConnections::compilePlans()
+{
+    // Connections of the same kind have the same bits, so only a few dozen plans per tile
+    // are distinct.
+    QHash<QByteArray, quint16> planIndexes;
+    plans.clear();
+    connectionPlans.resize(buffersCount + routingCount);
+    drivesWhenClear = false;
+    for(quint32 index = 0; index != buffersCount + routingCount; index++) {
+        if(srcNet(index, 0) != -1) drivesWhenClear = true;
+
+        const nbit_t *connBits = bits + connections[index].bitsBegin;
+        quint32 count          = connections[index].bitsCount;
+        QByteArray key         = QByteArray::fromRawData(reinterpret_cast<const char *>(connBits),
+                                                         count * sizeof(nbit_t));
+
+        auto it = planIndexes.constFind(key);
+        if(it == planIndexes.constEnd()) {
+            plans.append(ExtractPlan::fromFunction(connBits, count));
+            it = planIndexes.insert(key, plans.size() - 1);
+        }
+        connectionPlans[index] = *it;
+    }
+}
+
+ChipDB::ConnectionSource::ConnectionSource()
+{
+    setCacheBudget(DEFAULT_CONNECTION_CACHE_BUDGET);
+}
+
+ChipDB::ConnectionSource::~ConnectionSource()
+{}
+
+QSharedPointer<const ChipDB::TileConnections>
+ChipDB::ConnectionSource::tileConnections(const ChipDB &db, coord_t x, coord_t y)
+{
+    typedef QSharedPointer<const TileConnections> Entry;
+
+    const Tile *tile = db.findTile(x, y);
+    if(!tile) return nullptr;
+
+    int key = x << 8 | y;
+    QMutexLocker locker(&_mutex);
+    if(const Entry *cached = _cache.object(key)) return *cached;
+    locker.unlock();
+
+    // Decoded without holding the lock, so that other tiles can be decoded meanwhile.
+    QSharedPointer<TileConnections> result(new TileConnections);
+    if(!decode(db, *tile, result.data())) return nullptr;
+    result->compilePlans();
+
+    locker.relock();
+    if(const Entry *cached = _cache.object(key)) return *cached;
+    _cache.insert(key, new Entry(result), qMin<qint64>(result->memorySize(), INT_MAX));
+    return result;
+}
+
+bool ChipDB::ConnectionSource::drivesWhenClear(const ChipDB &db, coord_t x, coord_t y)
+{
+    const Tile *tile = db.findTile(x, y);
+    if(!tile) return false;
+
+    QMutexLocker locker(&_mutex);
+    auto it = _drivesWhenClear.constFind(tile->type);
+    if(it != _drivesWhenClear.constEnd()) return *it;
+    locker.unlock();
+
+    // A tile that cannot be decoded is said to drive, so that the caller decodes it and
+    // reports why it cannot.
+    QSharedPointer<const TileConnections> connections = tileConnections(db, x, y);
+    if(!connections) return true;
+
+    locker.relock();
+    _drivesWhenClear.insert(tile->type, connections->drivesWhenClear);
+    return connections->drivesWhenClear;
+}
+
+qint64 ChipDB::ConnectionSource::cacheBudget() const
+{
+    QMutexLocker locker(&_mutex);
+    return _cache.maxCost();
+}
+
+void ChipDB::ConnectionSource::setCacheBudget(qint64 bytes)
+{
+    QMutexLocker locker(&_mutex);
+    _cache.setMaxCost(qBound<qint64>(0, bytes, INT_MAX));
+}
+
+qint64 ChipDB::ConnectionSource::cacheUsage() const
+{
+    QMutexLocker locker(&_mutex);
+    return _cache.totalCost();
+}
+
+// The memory allocated for the elements of `vector`, in bytes.
+template <class T>
+static qint64 memorySizeOf(const QVector<T> &vector)
+{
+    return qint64(vector.capacity()) * sizeof(T);
 }
 
-QMap<QString, net_t> ChipDB::tileNets(coord_t x, coord_t y)
+static qint64 memorySizeOf(const QString &string)
 {
-    return tilesNets[qMakePair(x, y)];
+    return qint64(string.capacity()) * sizeof(QChar);
 }
 
-net_t ChipDB::tileNet(coord_t x, coord_t y, const QString &name)
+qint64 ChipDB::TileConnections::memorySize() const
 {
-    return tilesNets[qMakePair(x, y)][name];
+    qint64 size = sizeof(TileConnections);
+    for(const ExtractPlan &plan : plans) {
+        size += plan.memorySize();
+    }
+    size += memorySizeOf(connectionPlans);
+    size += memorySizeOf(ownConnections) + memorySizeOf(ownBits) + memorySizeOf(ownSrcNets);
+    return size;
+}
+
+qint64 ChipDB::memorySize() const
+{
+    qint64 size = sizeof(ChipDB);
+    for(const Package &package : packages) {
+        size += sizeof(Package) + memorySizeOf(package.name);
+        for(const Pin &pin : package.pins) {
+            size += sizeof(Pin) + memorySizeOf(pin.name);
+        }
+    }
+    for(const TileBits &tileBits : tilesBits) {
+        size += sizeof(TileBits);
+        for(const QVector<nbit_t> &bits : tileBits.functions) {
+            size += memorySizeOf(bits);
+        }
+        for(const ExtractPlan &plan : tileBits.functionPlans) {
+            size += plan.memorySize();
+        }
+    }
+
+    // The tiles of a type share the string of its name.
+    size += tiles.memorySize();
+    QSet<const QChar *> types;
+    for(const Tile &tile : tiles) {
+        if(!types.contains(tile.type.constData())) {
+            types.insert(tile.type.constData());
+            size += memorySizeOf(tile.type);
+        }
+    }
+
+    if(connectionSource) {
+        size += connectionSource->memorySize() + connectionSource->cacheUsage();
+    }
+
+    // Net tables used in place are counted with their image, if at all.
+    size += memorySizeOf(netTables.ownOffsets) + memorySizeOf(netTables.ownSegments);
+    size += memorySizeOf(netTables.ownTileOffsets) + memorySizeOf(netTables.ownTileNets);
+    for(const TileNetSlots &tileSlots : tileNetSlots) {
+        // The keys of `slotOf` share their strings with `names`.
+        size += memorySizeOf(tileSlots.names);
+        size += qint64(tileSlots.slotOf.capacity()) * (sizeof(QString) + sizeof(slot_t));
+        for(const QString &name : tileSlots.names) {
+            size += memorySizeOf(name);
+        }
+    }
+
+    size += memorySizeOf(gbufIns) + memorySizeOf(gbufPins) + memorySizeOf(colBufs);
+    size += memorySizeOf(globalNetworks) + memorySizeOf(globalNetworkColumnBuffers);
+    size += memorySizeOf(columnBuffers) + tileColumnBuffers.memorySize();
+
+    size += memorySizeOf(cout) + memorySizeOf(lout) + memorySizeOf(lcout) + memorySizeOf(ioin);
+    return size;
 }
 
-static nbit_t parseBitdef(QString bitdef, nbit_t columns)
+static nbit_t parseBitdef(QLatin1String bitdef, nbit_t columns)
 {
-    static const QRegularExpression re("^B([0-9]+)\\[([0-9]+)\\]$");
-    QRegularExpressionMatch match = re.match(bitdef);
-    if(!match.hasMatch()) {
+    // Matches ^B([0-9]+)\[([0-9]+)\]$.
+    const char *p = bitdef.data(), *end = p + bitdef.size();
+    auto parseNumber = [&](uint &value) {
+        const char *start = p;
+        for(value = 0; p != end && *p >= '0' && *p <= '9'; p++) {
+            value = value * 10 + (*p - '0');
+        }
+        return p != start;
+    };
+
+    uint row, col;
+    if(!(p != end && *p++ == 'B' && parseNumber(row) && p != end && *p++ == '[' &&
+         parseNumber(col) && p != end && *p++ == ']' && p == end)) {
         qCritical() << "malformed bitdef" << bitdef;
         return (nbit_t)-1;
     }
 
-    nbit_t row = match.capturedRef(1).toInt();
-    nbit_t col = match.capturedRef(2).toInt();
     return row * columns + col;
 }
 
-bool ChipDB::parse(QIODevice *in, std::function<void(int, int)> progress)
+namespace
+{
+struct PartialSegment {
+    coord_t tileX;
+    coord_t tileY;
+    int name;
+};
+
+struct PartialNet {
+    net_t num;
+    int segmentsBegin;
+    int segmentsEnd;
+};
+
+// A .buffer or .routing section, which is only decoded once its tile is used.
+struct PartialSection {
+    coord_t tileX;
+    coord_t tileY;
+    bool routing;
+    quint32 offset;
+    int lineno;
+};
+
+// The result of parsing one chunk of a chipdb, which starts `offset` bytes into the text.
+struct PartialChipDB {
+    AscParser::Chunk chunk;
+    qint64 offset;
+    bool ok;
+
+    ChipDB db;
+    bool hasDevice;
+    size_t numNets;
+    QVector<PartialSection> sections;
+    // The segments of the nets refer to their names by index into `names`, since the types
+    // of their tiles, and so their slots, are only known once all chunks are merged.
+    QVector<PartialNet> nets;
+    QVector<PartialSegment> segments;
+    QVector<QString> names;
+    QHash<QString, int> nameIndexes;
+};
+}
+
+static int internName(PartialChipDB &part, const QString &name)
+{
+    auto it = part.nameIndexes.constFind(name);
+    if(it != part.nameIndexes.constEnd()) return *it;
+
+    part.names.append(name);
+    return *part.nameIndexes.insert(name, part.names.size() - 1);
+}
+
+// The connections of a chipdb parsed from text, which are decoded from the text of their
+// sections when their tile is first used. The text is memory-mapped if it is a file, and
+// kept in memory otherwise.
+class TextConnections : public ChipDB::ConnectionSource
 {
-    AscParser parser(in);
+public:
+    struct Section {
+        quint32 offset;
+        int lineno;
+    };
+
+    const char *text;
+    qint64 size;
+    // The sections of the buffers of tile (x, y) are sections[sectionOffsets[index]] up to
+    // sections[sectionOffsets[index + 1]], for index = 2 * (x * height + y), followed by
+    // those of its routing switches.
+    int height;
+    QVector<quint32> sectionOffsets;
+    QVector<Section> sections;
+
+    TextConnections() : text(nullptr), size(0), height(0), _map(nullptr)
+    {}
+
+    ~TextConnections()
+    {
+        if(_map) _file.unmap(_map);
+    }
+
+    // Read or map the rest of `in`. While reading, `progress` is called after every chunk,
+    // and loading stops if it returns false.
+    bool load(QIODevice *in, std::function<bool()> progress);
+    qint64 memorySize() const override;
+
+protected:
+    bool decode(const ChipDB &db, const ChipDB::Tile &tile,
+                ChipDB::TileConnections *result) const override;
+
+private:
+    QFile _file;
+    uchar *_map;
+    QByteArray _data;
+};
+
+static const qint64 MIN_CHUNK_SIZE = 64 * 1024;
+// How much of a device that cannot be mapped is read at once.
+static const qint64 READ_CHUNK_SIZE = 1 << 20;
+// How often, in ms, the progress of a parallel parse is reported.
+static const int PROGRESS_INTERVAL = 10;
+
+template <class Sequence, class Function>
+static void forEach(Sequence &sequence, Function function, ChipDB::ParseMode mode)
+{
+    if(mode == ChipDB::ParallelParse && sequence.size() > 1) {
+        QtConcurrent::blockingMap(sequence, function);
+    } else {
+        for(auto &item : sequence) {
+            function(item);
+        }
+    }
+}
+
+static bool parseChunk(AscParser &parser, PartialChipDB &part, std::function<bool()> progress)
+{
+    part.hasDevice = false;
+    part.numNets   = 0;
+
     while(parser.isOk() && !parser.atEnd()) {
-        progress(in->pos(), in->size());
-
-        QString command = parser.parseCommand();
-        if(command == "device") {
-            QString name    = parser.parseName();
-            width           = parser.parseDecimal();
-            height          = parser.parseDecimal();
-            size_t num_nets = parser.parseDecimal();
+        if(!progress()) return false;
+
+        AscParser::Command command = parser.parseCommand();
+        switch(command) {
+        case AscParser::Device: {
+            part.db.name   = parser.parseName();
+            part.db.width  = parser.parseDecimal();
+            part.db.height = parser.parseDecimal();
+            part.numNets   = parser.parseDecimal();
             parser.parseEol();
 
-            Q_ASSERT(this->name == "" || this->name == name);
-            this->name = name;
+            part.hasDevice = true;
+            break;
+        }
 
-            nets.fill(Net{-1, {}}, num_nets);
-            cout.fill(-1, 8 * width * height);
-            lout.fill(-1, 7 * width * height);
-            lcout.fill(-1, 8 * width * height);
-            ioin.fill(-1, 4 * width * height);
-        } else if(command == "pins") {
-            Package package;
+        case AscParser::Pins: {
+            ChipDB::Package package;
             package.name = parser.parseName();
 
             while(parser.isOk() && !parser.atCommand()) {
-                Pin pin;
+                ChipDB::Pin pin;
                 pin.name  = parser.parseName();
                 pin.tileX = parser.parseDecimal();
                 pin.tileY = parser.parseDecimal();
@@ -72,39 +444,85 @@ bool ChipDB::parse(QIODevice *in, std::function<void(int, int)> progress)
                 package.pins[pin.name] = pin;
             }
 
-            packages[package.name] = package;
-        } else if(command == "gbufin") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "gbufpin") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "iolatch") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "ieren") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "colbuf") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "io_tile" || command == "logic_tile" || command == "ramb_tile" ||
-                  command == "ramt_tile" || command == "dsp0_tile" || command == "dsp1_tile" ||
-                  command == "dsp2_tile" || command == "dsp3_tile" || command == "ipcon_tile") {
-            Tile tile;
-            tile.type = command.left(command.indexOf("_"));
-            tile.x    = parser.parseDecimal();
-            tile.y    = parser.parseDecimal();
+            part.db.packages[package.name] = package;
+            break;
+        }
+
+        case AscParser::GBufIn: {
+            parser.parseEol();
+            while(parser.isOk() && !parser.atCommand()) {
+                ChipDB::GBufIn gbufIn;
+                gbufIn.x       = parser.parseDecimal();
+                gbufIn.y       = parser.parseDecimal();
+                gbufIn.network = parser.parseDecimal();
+                parser.parseEol();
+
+                part.db.gbufIns.append(gbufIn);
+            }
+            break;
+        }
+
+        case AscParser::GBufPin: {
             parser.parseEol();
+            while(parser.isOk() && !parser.atCommand()) {
+                ChipDB::GBufPin gbufPin;
+                gbufPin.x       = parser.parseDecimal();
+                gbufPin.y       = parser.parseDecimal();
+                gbufPin.pio     = parser.parseDecimal();
+                gbufPin.network = parser.parseDecimal();
+                parser.parseEol();
+
+                part.db.gbufPins.append(gbufPin);
+            }
+            break;
+        }
 
-            this->tile(tile.x, tile.y) = tile;
-        } else if(command == "io_tile_bits" || command == "logic_tile_bits" ||
-                  command == "ramb_tile_bits" || command == "ramt_tile_bits" ||
-                  command == "dsp0_tile_bits" || command == "dsp1_tile_bits" ||
-                  command == "dsp2_tile_bits" || command == "dsp3_tile_bits" ||
-                  command == "ipcon_tile_bits") {
-            TileBits tile_bits;
-            tile_bits.type    = command.left(command.indexOf("_"));
+        case AscParser::ColBuf: {
+            parser.parseEol();
+            while(parser.isOk() && !parser.atCommand()) {
+                ChipDB::ColBuf colBuf;
+                colBuf.srcX = parser.parseDecimal();
+                colBuf.srcY = parser.parseDecimal();
+                colBuf.dstX = parser.parseDecimal();
+                colBuf.dstY = parser.parseDecimal();
+                parser.parseEol();
+
+                part.db.colBufs.append(colBuf);
+            }
+            break;
+        }
+
+        case AscParser::IOTile:
+        case AscParser::LogicTile:
+        case AscParser::RAMBTile:
+        case AscParser::RAMTTile:
+        case AscParser::DSP0Tile:
+        case AscParser::DSP1Tile:
+        case AscParser::DSP2Tile:
+        case AscParser::DSP3Tile:
+        case AscParser::IPConTile: {
+            coord_t tile_x = parser.parseDecimal();
+            coord_t tile_y = parser.parseDecimal();
+            parser.parseEol();
+
+            ChipDB::Tile &tile = part.db.tile(tile_x, tile_y);
+            tile.x             = tile_x;
+            tile.y             = tile_y;
+            tile.type          = AscParser::tileType(command);
+            break;
+        }
+
+        case AscParser::IOTileBits:
+        case AscParser::LogicTileBits:
+        case AscParser::RAMBTileBits:
+        case AscParser::RAMTTileBits:
+        case AscParser::DSP0TileBits:
+        case AscParser::DSP1TileBits:
+        case AscParser::DSP2TileBits:
+        case AscParser::DSP3TileBits:
+        case AscParser::IPConTileBits: {
+            ChipDB::TileBits tile_bits;
+            tile_bits.type    = AscParser::tileType(command);
             tile_bits.columns = parser.parseDecimal();
             tile_bits.rows    = parser.parseDecimal();
             parser.parseEol();
@@ -122,68 +540,487 @@ bool ChipDB::parse(QIODevice *in, std::function<void(int, int)> progress)
                 tile_bits.functions[func] = bits;
             }
 
-            tilesBits[tile_bits.type] = tile_bits;
-        } else if(command == "extra_cell") {
-            // not implemented
-            parser.skipToCommand();
-        } else if(command == "extra_bits") {
+            part.db.tilesBits[tile_bits.type] = tile_bits;
+            break;
+        }
+
+        case AscParser::ExtraCell:
+        case AscParser::ExtraBits:
+        case AscParser::IOLatch:
+        case AscParser::IERen:
             // not implemented
             parser.skipToCommand();
-        } else if(command == "net") {
-            Net net;
-            net.num = parser.parseDecimal();
+            break;
+
+        case AscParser::Net: {
+            PartialNet net;
+            net.num           = parser.parseDecimal();
+            net.segmentsBegin = part.segments.size();
             parser.parseEol();
 
             while(parser.isOk() && !parser.atCommand()) {
-                TileNet entry;
-                entry.tileX = parser.parseDecimal();
-                entry.tileY = parser.parseDecimal();
-                entry.name  = parser.parseName();
+                PartialSegment segment;
+                segment.tileX = parser.parseDecimal();
+                segment.tileY = parser.parseDecimal();
+                segment.name  = internName(part, parser.parseName());
                 parser.parseEol();
 
-                net.tileNets.append(entry);
+                part.segments.append(segment);
             }
 
-            nets[net.num] = net;
-        } else if(command == "buffer" || command == "routing") {
-            Connection conn;
-            coord_t tile_x = parser.parseDecimal();
-            coord_t tile_y = parser.parseDecimal();
-            nbit_t columns = tilesBits[tile(tile_x, tile_y).type].columns;
-            conn.dstNet    = parser.parseDecimal();
-            while(parser.isOk() && !parser.atEol()) {
-                nbit_t bit = parseBitdef(parser.parseName(), columns);
-                if(bit == (nbit_t)-1) return false;
-                conn.bits.append(bit);
+            net.segmentsEnd = part.segments.size();
+            part.nets.append(net);
+            break;
+        }
+
+        case AscParser::Buffer:
+        case AscParser::Routing: {
+            // Only the position of the section is recorded; it is decoded with its tile.
+            PartialSection section;
+            section.offset  = part.offset + parser.linePos();
+            section.lineno  = parser.lineNumber();
+            section.tileX   = parser.parseDecimal();
+            section.tileY   = parser.parseDecimal();
+            section.routing = command == AscParser::Routing;
+            parser.skipToCommand();
+
+            part.sections.append(section);
+            break;
+        }
+
+        default:
+            qCritical() << "unexpected command" << "." + QString(parser.commandName());
+            return false;
+        }
+    }
+
+    return parser.isOk();
+}
+
+bool TextConnections::load(QIODevice *in, std::function<bool()> progress)
+{
+    // The caller's file may be closed once parsing is done, so the file is opened again to
+    // keep the mapping alive.
+    qint64 offset = in->pos();
+    QFile *file   = qobject_cast<QFile *>(in);
+    if(file && !file->fileName().isEmpty() && in->size() > offset) {
+        _file.setFileName(file->fileName());
+        if(_file.open(QIODevice::ReadOnly)) _map = _file.map(offset, in->size() - offset);
+    }
+
+    if(_map) {
+        text = reinterpret_cast<const char *>(_map);
+        size = in->size() - offset;
+    } else {
+        // Read in chunks, so that e.g. decompression reports its progress as it goes.
+        QByteArray chunk;
+        while(!(chunk = in->read(READ_CHUNK_SIZE)).isEmpty()) {
+            _data += chunk;
+            if(!progress()) return false;
+        }
+        if(!in->atEnd()) {
+            qCritical() << "cannot read chipdb" << in->errorString();
+            return false;
+        }
+        text = _data.constData();
+        size = _data.size();
+    }
+
+    if(size > std::numeric_limits<quint32>::max()) {
+        qCritical() << "chipdb is too large";
+        return false;
+    }
+    return true;
+}
+
+qint64 TextConnections::memorySize() const
+{
+    // A mapped file is paged in and out by the system, so only text read into memory counts.
+    return sizeof(TextConnections) + _data.capacity() + memorySizeOf(sectionOffsets) +
+           memorySizeOf(sections);
+}
+
+static bool parseConnection(AscParser &parser, nbit_t columns, QVector<nbit_t> &bits,
+                            QVector<net_t> &srcNets, ChipDB::Connection *conn)
+{
+    conn->dstNet    = parser.parseDecimal();
+    conn->bitsBegin = bits.size();
+    while(parser.isOk() && !parser.atEol()) {
+        nbit_t bit = parseBitdef(parser.parseName(), columns);
+        if(bit == (nbit_t)-1) return false;
+        bits.append(bit);
+    }
+    conn->bitsCount = bits.size() - conn->bitsBegin;
+    if(conn->bitsCount > 16) {
+        qCritical() << "at line" << parser.lineNumber() << "connection has too many bits";
+        return false;
+    }
+
+    conn->srcNetsBegin = srcNets.size();
+    srcNets.resize(conn->srcNetsBegin + (1 << conn->bitsCount));
+    std::fill(srcNets.begin() + conn->srcNetsBegin, srcNets.end(), -1);
+    parser.parseEol();
+
+    while(parser.isOk() && !parser.atCommand()) {
+        uint config = parser.parseBinary();
+        if(config >> conn->bitsCount) {
+            qCritical() << "at line" << parser.lineNumber() << "configuration is out of range";
+            return false;
+        }
+        srcNets[conn->srcNetsBegin + config] = parser.parseDecimal();
+        parser.parseEol();
+    }
+
+    return parser.isOk();
+}
+
+bool TextConnections::decode(const ChipDB &db, const ChipDB::Tile &tile,
+                             ChipDB::TileConnections *result) const
+{
+    // Every tile with connections has tile bits, which was checked when it was parsed.
+    int index      = 2 * (tile.x * height + tile.y);
+    nbit_t columns = db.tilesBits.value(tile.type).columns;
+    for(quint32 entry = sectionOffsets[index]; entry != sectionOffsets[index + 2]; entry++) {
+        const Section &section = sections[entry];
+        AscParser parser(AscParser::Chunk{text + section.offset, text + size, section.lineno});
+        parser.parseCommand();
+        parser.parseDecimal();
+        parser.parseDecimal();
+
+        ChipDB::Connection conn;
+        if(!parseConnection(parser, columns, result->ownBits, result->ownSrcNets, &conn)) {
+            return false;
+        }
+        result->ownConnections.append(conn);
+    }
+
+    result->connections  = result->ownConnections.constData();
+    result->buffersCount = sectionOffsets[index + 1] - sectionOffsets[index];
+    result->routingCount = sectionOffsets[index + 2] - sectionOffsets[index + 1];
+    result->bits         = result->ownBits.constData();
+    result->srcNets      = result->ownSrcNets.constData();
+    return true;
+}
+
+bool ChipDB::parse(QIODevice *in, std::function<bool(int, int)> progress, ParseMode mode)
+{
+    QSharedPointer<TextConnections> source(new TextConnections);
+    if(!source->load(in, [&] { return progress(in->pos(), in->size()); })) return false;
+
+    AscParser parser(AscParser::Chunk{source->text, source->text + source->size, 0});
+    int count = 1;
+    if(mode == ParallelParse) {
+        count = qBound<qint64>(1, parser.size() / MIN_CHUNK_SIZE,
+                               QThreadPool::globalInstance()->maxThreadCount() * 4);
+    }
+
+    QVector<PartialChipDB> parts;
+    for(const AscParser::Chunk &chunk : parser.splitAtCommands(count)) {
+        PartialChipDB part;
+        part.chunk  = chunk;
+        part.offset = chunk.begin - source->text;
+        parts.append(part);
+    }
+
+    // Parse every chunk on its own. The chunks add what they parsed to `done`, which only this
+    // thread reports, while it waits for them in parallel mode; they stop once it is cancelled.
+    QAtomicInt done(0);
+    QAtomicInt cancelled(0);
+    QThread *reporter = QThread::currentThread();
+    int total         = parser.size();
+    auto report       = [&] {
+        if(!progress(done.load(), total)) cancelled.store(1);
+    };
+    auto parsePart = [&](PartialChipDB &part) {
+        AscParser chunkParser(part.chunk);
+        qint64 parsed = 0;
+        part.ok       = parseChunk(chunkParser, part, [&] {
+            done.fetchAndAddRelaxed(chunkParser.pos() - parsed);
+            parsed = chunkParser.pos();
+            if(QThread::currentThread() == reporter) report();
+            return !cancelled.load();
+        });
+    };
+    if(mode == ParallelParse && parts.size() > 1) {
+        QFuture<void> parsing = QtConcurrent::map(parts, parsePart);
+        while(!parsing.isFinished()) {
+            report();
+            QThread::msleep(PROGRESS_INTERVAL);
+        }
+    } else {
+        for(PartialChipDB &part : parts) {
+            parsePart(part);
+        }
+    }
+
+    for(const PartialChipDB &part : parts) {
+        if(!part.ok) return false;
+    }
+
+    // Merge the declarations in file order, such that the tile types and tile bits are known
+    // for every tile before any connections are merged.
+    size_t numNets = 0;
+    for(const PartialChipDB &part : parts) {
+        if(part.hasDevice) {
+            Q_ASSERT(this->name == "" || this->name == part.db.name);
+            name    = part.db.name;
+            width   = part.db.width;
+            height  = part.db.height;
+            numNets = part.numNets;
+        }
+
+        for(auto it = part.db.packages.begin(); it != part.db.packages.end(); ++it) {
+            packages[it.key()] = *it;
+        }
+
+        for(auto it = part.db.tilesBits.begin(); it != part.db.tilesBits.end(); ++it) {
+            tilesBits[it.key()] = *it;
+        }
+
+        gbufIns  += part.db.gbufIns;
+        gbufPins += part.db.gbufPins;
+        colBufs  += part.db.colBufs;
+
+        for(const Tile &partTile : part.db.tiles) {
+            if(partTile.type.isEmpty()) continue;
+
+            Tile &tile = this->tile(partTile.x, partTile.y);
+            tile.x     = partTile.x;
+            tile.y     = partTile.y;
+            tile.type  = partTile.type;
+        }
+    }
+
+    tiles.resize(qMax<int>(tiles.width(), width), qMax<int>(tiles.height(), height));
+    initNets(numNets);
+
+    // Index the sections of the connections tile by tile, with the buffers of each tile
+    // before its routing switches, and in file order otherwise. First count them, then place
+    // them.
+    source->height = tiles.height();
+    source->sectionOffsets.fill(0, 2 * tiles.width() * tiles.height() + 1);
+    auto sectionIndex = [&](const PartialSection &section) {
+        return 2 * (section.tileX * tiles.height() + section.tileY) + section.routing;
+    };
+    for(const PartialChipDB &part : parts) {
+        for(const PartialSection &section : part.sections) {
+            Tile *tile = tiles.find(section.tileX, section.tileY);
+            if(!tile || tile->type.isEmpty() || !tilesBits.contains(tile->type)) {
+                qCritical() << "tile at" << section.tileX << section.tileY
+                            << "has connections but no tile bits";
+                return false;
             }
-            conn.srcNets.fill(-1, 1 << conn.bits.length());
-            parser.parseEol();
 
-            while(parser.isOk() && !parser.atCommand()) {
-                int config           = parser.parseBinary();
-                conn.srcNets[config] = parser.parseDecimal();
-                parser.parseEol();
+            source->sectionOffsets[sectionIndex(section) + 1]++;
+        }
+    }
+    for(int index = 1; index < source->sectionOffsets.size(); index++) {
+        source->sectionOffsets[index] += source->sectionOffsets[index - 1];
+    }
+
+    source->sections.resize(source->sectionOffsets.last());
+    QVector<quint32> nextSection = source->sectionOffsets;
+    for(const PartialChipDB &part : parts) {
+        for(const PartialSection &section : part.sections) {
+            source->sections[nextSection[sectionIndex(section)]++] =
+                TextConnections::Section{section.offset, section.lineno};
+        }
+    }
+    connectionSource = source;
+
+    // Lay out the segments of the nets contiguously, net by net, and in file order within
+    // each net.
+    QVector<quint32> &netOffsets     = netTables.ownOffsets;
+    QVector<NetSegment> &netSegments = netTables.ownSegments;
+    for(const PartialChipDB &part : parts) {
+        for(const PartialNet &net : part.nets) {
+            if(net.num < 0 || net.num >= netCount()) {
+                qCritical() << "net" << net.num << "is out of range";
+                return false;
             }
 
-            if(command == "buffer") {
-                tile(tile_x, tile_y).buffers.append(conn);
-            } else if(command == "routing") {
-                tile(tile_x, tile_y).routing.append(conn);
+            netOffsets[net.num + 1] += net.segmentsEnd - net.segmentsBegin;
+        }
+    }
+    for(int net = 0; net < netCount(); net++) {
+        netOffsets[net + 1] += netOffsets[net];
+    }
+
+    netSegments.resize(netOffsets.last());
+    QVector<quint32> nextSegment = netOffsets;
+    for(const PartialChipDB &part : parts) {
+        for(const PartialNet &net : part.nets) {
+            for(int index = net.segmentsBegin; index != net.segmentsEnd; index++) {
+                const PartialSegment &segment = part.segments[index];
+                const Tile *tile              = findTile(segment.tileX, segment.tileY);
+
+                NetSegment &result = netSegments[nextSegment[net.num]++];
+                result.tileX       = segment.tileX;
+                result.tileY       = segment.tileY;
+                result.slot        = -1;
+                if(tile) result.slot = addTileNetSlot(tile->type, part.names[segment.name]);
             }
-        } else {
-            qCritical() << "unexpected command"
-                        << "." + command;
-            return false;
         }
     }
 
-    for(Net &net : nets) {
-        for(TileNet &tileNet : net.tileNets) {
-            auto coord = qMakePair(tileNet.tileX, tileNet.tileY);
+    buildTilesNets(mode);
+    buildGlobalNetworks();
+    buildExtractPlans();
+    return true;
+}
+
+void ChipDB::initNets(size_t numNets)
+{
+    netTables          = NetTables();
+    netTables.netCount = numNets;
+    netTables.ownOffsets.fill(0, numNets + 1);
+    tileNetSlots.clear();
+    cout.fill(-1, 8 * width * height);
+    lout.fill(-1, 7 * width * height);
+    lcout.fill(-1, 8 * width * height);
+    ioin.fill(-1, 4 * width * height);
+}
+
+slot_t ChipDB::addTileNetSlot(const QString &type, const QString &name)
+{
+    TileNetSlots &layout = tileNetSlots[type];
+    auto it              = layout.slotOf.constFind(name);
+    if(it != layout.slotOf.constEnd()) return *it;
+
+    layout.names.append(name);
+    return *layout.slotOf.insert(name, layout.names.size() - 1);
+}
+
+void ChipDB::buildTilesNets(ParseMode mode)
+{
+    netTables.offsets  = netTables.ownOffsets.constData();
+    netTables.segments = netTables.ownSegments.constData();
+
+    // Every tile has a table as large as the slot table of its type.
+    QVector<quint32> &tileOffsets = netTables.ownTileOffsets;
+    tileOffsets.fill(0, width * height + 1);
+    for(int index = 0; index < width * height; index++) {
+        const Tile *tile = findTile(index / height, index % height);
+        auto layout      = tile ? tileNetSlots.constFind(tile->type) : tileNetSlots.constEnd();
+        int count        = layout != tileNetSlots.constEnd() ? layout->names.size() : 0;
+        tileOffsets[index + 1] = tileOffsets[index] + count;
+    }
+    netTables.ownTileNets.fill(-1, tileOffsets.last());
+    netTables.tileOffsets = tileOffsets.constData();
+    netTables.tileNets    = netTables.ownTileNets.constData();
+
+    // Each (tile, slot) pair belongs to a single net, so shards that take disjoint ranges of
+    // nets fill in disjoint entries of the table, which is written to in place. The ranges
+    // have about as many segments each.
+    net_t *tileNets = netTables.ownTileNets.data();
+    int shardCount  = mode == ParallelParse ? QThreadPool::globalInstance()->maxThreadCount() : 1;
+    auto shardBegin = [&](int shard) {
+        if(shard == shardCount) return netCount();
+
+        quint32 segment = quint64(netTables.ownSegments.size()) * shard / shardCount;
+        return net_t(std::lower_bound(netTables.offsets, netTables.offsets + netCount() + 1,
+                                      segment) -
+                     netTables.offsets);
+    };
+    QVector<QPair<net_t, net_t>> shards;
+    for(int shard = 0; shard < shardCount; shard++) {
+        shards.append(qMakePair(shardBegin(shard), shardBegin(shard + 1)));
+    }
+
+    forEach(shards,
+            [&](QPair<net_t, net_t> &shard) {
+                for(net_t net = shard.first; net != shard.second; net++) {
+                    for(const NetSegment *segment = netSegmentsBegin(net);
+                        segment != netSegmentsEnd(net); segment++) {
+                        if(segment->tileX >= width || segment->tileY >= height ||
+                           segment->slot == -1) {
+                            continue;
+                        }
+
+                        int index     = segment->tileX * height + segment->tileY;
+                        quint32 entry = netTables.tileOffsets[index] + segment->slot;
+                        if(entry < netTables.tileOffsets[index + 1]) tileNets[entry] = net;
+                    }
+                }
+            },
+            mode);
+}
+
+void ChipDB::buildGlobalNetworks()
+{
+    int networkCount = 0;
+    for(const GBufIn &gbufIn : gbufIns) {
+        networkCount = qMax(networkCount, gbufIn.network + 1);
+    }
+    for(const GBufPin &gbufPin : gbufPins) {
+        networkCount = qMax(networkCount, gbufPin.network + 1);
+    }
+
+    globalNetworks.fill(GlobalNetwork{-1, -1, -1, 0, 0}, networkCount);
+    for(int network = 0; network < networkCount; network++) {
+        // Every tile reached by a global network names it the same.
+        QString name = QString("glb_netwk_%1").arg(network);
+        for(const Tile &tile : tiles) {
+            slot_t slot = tileNetSlot(tile.type, name);
+            if(slot == -1) continue;
+
+            globalNetworks[network].net = tileNet(tile.x, tile.y, slot);
+            break;
+        }
+    }
+    for(int index = 0; index < gbufIns.size(); index++) {
+        globalNetworks[gbufIns[index].network].gbufIn = index;
+    }
+    for(int index = 0; index < gbufPins.size(); index++) {
+        globalNetworks[gbufPins[index].network].gbufPin = index;
+    }
+
+    // Group the tiles driven by each column buffer.
+    auto key = [](const ColBuf &colBuf) {
+        return quint32(colBuf.srcX) << 24 | colBuf.srcY << 16 | colBuf.dstX << 8 | colBuf.dstY;
+    };
+    std::sort(colBufs.begin(), colBufs.end(),
+              [&](const ColBuf &a, const ColBuf &b) { return key(a) < key(b); });
 
-            tilesNets[coord][tileNet.name] = net.num;
+    columnBuffers.clear();
+    tileColumnBuffers.clear();
+    tileColumnBuffers.resize(width, height);
+    for(int index = 0; index < colBufs.size(); index++) {
+        const ColBuf &colBuf = colBufs[index];
+        if(columnBuffers.isEmpty() || columnBuffers.last().x != colBuf.srcX ||
+           columnBuffers.last().y != colBuf.srcY) {
+            columnBuffers.append(ColumnBuffer{colBuf.srcX, colBuf.srcY, quint32(index), 0});
         }
+        columnBuffers.last().colBufsEnd = index + 1;
+        tileColumnBuffers.insert(colBuf.dstX, colBuf.dstY, columnBuffers.size() - 1);
     }
 
-    return parser.isOk();
+    // The column buffers of the tiles that each network reaches, in order.
+    globalNetworkColumnBuffers.clear();
+    for(GlobalNetwork &globalNetwork : globalNetworks) {
+        globalNetwork.columnBuffersBegin = globalNetworkColumnBuffers.size();
+        if(globalNetwork.net != -1) {
+            for(const NetSegment *segment = netSegmentsBegin(globalNetwork.net);
+                segment != netSegmentsEnd(globalNetwork.net); segment++) {
+                int columnBuffer = tileColumnBuffer(segment->tileX, segment->tileY);
+                if(columnBuffer != -1) globalNetworkColumnBuffers.append(columnBuffer);
+            }
+        }
+
+        auto begin = globalNetworkColumnBuffers.begin() + globalNetwork.columnBuffersBegin;
+        std::sort(begin, globalNetworkColumnBuffers.end());
+        globalNetworkColumnBuffers.erase(std::unique(begin, globalNetworkColumnBuffers.end()),
+                                         globalNetworkColumnBuffers.end());
+        globalNetwork.columnBuffersEnd = globalNetworkColumnBuffers.size();
+    }
+}
+
+void ChipDB::buildExtractPlans()
+{
+    for(TileBits &tileBits : tilesBits) {
+        tileBits.functionPlans.clear();
+        for(auto it = tileBits.functions.constBegin(); it != tileBits.functions.constEnd(); ++it) {
+            tileBits.functionPlans.insert(it.key(), ExtractPlan::fromFunction(*it));
+        }
+    }
 }
@@ -3,13 +3,20 @@
 
 #include <functional>
 
+#include <QCache>
+#include <QHash>
 #include <QIODevice>
 #include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
 #include <QVector>
+#include "extractplan.h"
+#include "tilegrid.h"
 
 typedef uint8_t coord_t;
 typedef uint16_t nbit_t;
 typedef int32_t net_t;
+typedef int32_t slot_t;
 
 class ChipDB
 {
@@ -31,49 +38,231 @@ public:
         nbit_t columns;
         nbit_t rows;
         QMap<QString, QVector<nbit_t>> functions;
+        // Compiled from `functions` by buildExtractPlans().
+        QMap<QString, ExtractPlan> functionPlans;
     };
 
+    // A buffer or routing switch, which drives `dstNet` from the one of its `1 << bitsCount`
+    // source nets selected by its configuration bits. The bits and the source nets are kept
+    // in the pools of the TileConnections it belongs to.
     struct Connection {
         net_t dstNet;
-        QVector<net_t> srcNets;
-        QVector<nbit_t> bits;
+        quint32 bitsBegin;
+        quint32 bitsCount;
+        quint32 srcNetsBegin;
     };
 
+    // Keeps the memory that connections or net tables used in place point into alive.
+    struct ConnectionStorage {
+        virtual ~ConnectionStorage()
+        {}
+    };
+
+    // The buffers of a tile, followed by its routing switches. The arrays may point straight
+    // into a memory-mapped or compiled-in chipdb image, which `storage` keeps alive.
+    struct TileConnections {
+        const Connection *connections;
+        quint32 buffersCount;
+        quint32 routingCount;
+        const nbit_t *bits;
+        const net_t *srcNets;
+        // Whether any of the connections drives a net while the bits of the tile are all
+        // clear. Set by compilePlans().
+        bool drivesWhenClear;
+        // The distinct extraction plans of the connections, and the plan of each one.
+        QVector<ExtractPlan> plans;
+        QVector<quint16> connectionPlans;
+
+        // Either the arrays are decoded into these, or `storage` holds what they point into.
+        QVector<Connection> ownConnections;
+        QVector<nbit_t> ownBits;
+        QVector<net_t> ownSrcNets;
+        QSharedPointer<const ConnectionStorage> storage;
+
+        const ExtractPlan &plan(quint32 index) const
+        {
+            return plans[connectionPlans[index]];
+        }
+
+        net_t srcNet(quint32 index, uint config) const
+        {
+            return srcNets[connections[index].srcNetsBegin + config];
+        }
+
+        // Compile `plans` and `connectionPlans` from the bits of the connections.
+        void compilePlans();
+        qint64 memorySize() const;
+    };
+
+    class ConnectionSource;
+
+    // The buffers and routing switches of a tile are decoded on first use by
+    // tileConnections().
     struct Tile {
         coord_t x;
         coord_t y;
         QString type;
-        QVector<Connection> buffers;
-        QVector<Connection> routing;
     };
 
-    struct TileNet {
+    // A net local to the tile at (tileX, tileY), named by its slot in the slot table of the
+    // tile's type. The slot is -1 if the tile isn't declared.
+    struct NetSegment {
         coord_t tileX;
         coord_t tileY;
-        QString name;
+        slot_t slot;
+    };
+
+    // The names of the nets local to the tiles of one type, each interned into a slot number
+    // that indexes the net tables of those tiles.
+    struct TileNetSlots {
+        QVector<QString> names;
+        QHash<QString, slot_t> slotOf;
+    };
+
+    // The segments of every net in compressed sparse row form: those of net `net` are
+    // segments[offsets[net]] up to segments[offsets[net + 1]]. And their reverse, the nets of
+    // each tile indexed by slot: those of the tile at (x, y) are tileNets[tileOffsets[index]]
+    // up to tileNets[tileOffsets[index + 1]], where `index` is x * height + y. The arrays may
+    // point straight into a memory-mapped or compiled-in chipdb image.
+    struct NetTables {
+        quint32 netCount;
+        const quint32 *offsets;
+        const NetSegment *segments;
+        const quint32 *tileOffsets;
+        const net_t *tileNets;
+
+        // Either the tables are built into these, or `storage` holds what they point into.
+        QVector<quint32> ownOffsets;
+        QVector<NetSegment> ownSegments;
+        QVector<quint32> ownTileOffsets;
+        QVector<net_t> ownTileNets;
+        QSharedPointer<const ConnectionStorage> storage;
+
+        NetTables();
+    };
+
+    // The global buffer of tile (x, y) can drive global network `network` from the fabric.
+    struct GBufIn {
+        coord_t x;
+        coord_t y;
+        quint8 network;
+    };
+
+    // The IO pin `pio` of tile (x, y) can drive global network `network` directly.
+    struct GBufPin {
+        coord_t x;
+        coord_t y;
+        quint8 pio;
+        quint8 network;
     };
 
-    struct Net {
-        net_t num;
-        QVector<TileNet> tileNets;
+    // The column buffer of tile (srcX, srcY) drives the global networks of tile (dstX, dstY).
+    struct ColBuf {
+        coord_t srcX;
+        coord_t srcY;
+        coord_t dstX;
+        coord_t dstY;
     };
 
+    // A global network and the buffers that can drive it, which are -1 if there are none.
+    // It reaches the tiles that its net has segments in, through their column buffers.
+    // globalNetworkColumnBuffers[columnBuffersBegin] to [columnBuffersEnd - 1] are the
+    // distinct column buffers of those tiles.
+    struct GlobalNetwork {
+        net_t net;
+        qint32 gbufIn;
+        qint32 gbufPin;
+        quint32 columnBuffersBegin;
+        quint32 columnBuffersEnd;
+    };
+
+    // A column buffer, which drives the global networks of the tiles colBufs[colBufsBegin]
+    // up to colBufs[colBufsEnd], for those networks enabled by its ColBufCtrl bits.
+    struct ColumnBuffer {
+        coord_t x;
+        coord_t y;
+        quint32 colBufsBegin;
+        quint32 colBufsEnd;
+    };
+
+    enum ParseMode { SerialParse, ParallelParse };
+
     ChipDB();
-    bool parse(QIODevice *in, std::function<void(int, int)> progress);
+    // `progress` is called periodically from the parsing threads, and parsing is cancelled
+    // if it returns false.
+    bool parse(QIODevice *in, std::function<bool(int, int)> progress,
+               ParseMode mode = SerialParse);
+
+    // Allocate the own net tables for `numNets` nets, using the current width and height.
+    void initNets(size_t numNets);
+    // Returns the slot of the net `name` in tiles of type `type`, adding it if there is none.
+    slot_t addTileNetSlot(const QString &type, const QString &name);
+    // Build the nets of each tile from the own net segments, and point the net tables at the
+    // own ones.
+    void buildTilesNets(ParseMode mode = SerialParse);
+    // Build the global network index from the global buffer and column buffer tables.
+    // Must be called after buildTilesNets().
+    void buildGlobalNetworks();
+    // Compile the bits of the functions of every tile type into extraction plans. The plans
+    // of the connections are compiled as their tiles are decoded.
+    void buildExtractPlans();
 
+    // Returns the tile at (x, y), adding it if there is none.
     Tile &tile(coord_t x, coord_t y);
-    QMap<QString, net_t> tileNets(coord_t x, coord_t y);
-    net_t tileNet(coord_t x, coord_t y, const QString &name);
+
+    // These never modify the chipdb, and are safe to call from any thread.
+    const Tile *findTile(coord_t x, coord_t y) const;
+    // Returns -1 if tiles of type `type` have no net `name`.
+    slot_t tileNetSlot(const QString &type, const QString &name) const;
+    // Returns -1 if the tile at (x, y) has no net in slot `slot`.
+    net_t tileNet(coord_t x, coord_t y, slot_t slot) const;
+    net_t tileNet(coord_t x, coord_t y, const QString &name) const;
+    QString tileNetName(coord_t x, coord_t y, slot_t slot) const;
+
+    int netCount() const;
+    const NetSegment *netSegmentsBegin(net_t net) const;
+    const NetSegment *netSegmentsEnd(net_t net) const;
+    // Returns the global network carried by `net`, or -1 if it isn't a global net.
+    int globalNetwork(net_t net) const;
+    // Returns the column buffer driving the global networks of tile (x, y), or -1.
+    int tileColumnBuffer(coord_t x, coord_t y) const;
+    // Returns an empty plan if tiles of type `type` have no function `name`.
+    const ExtractPlan &functionPlan(const QString &type, const QString &name) const;
+    // Returns the connections of the tile at (x, y), decoding them if they aren't cached, or
+    // null if they cannot be decoded.
+    QSharedPointer<const TileConnections> tileConnections(coord_t x, coord_t y) const;
+    // Returns whether a tile of the type of the tile at (x, y) may drive a net while its bits
+    // are all clear. If not, such tiles need not be decoded at all.
+    bool drivesWhenClear(coord_t x, coord_t y) const;
+
+    // An estimate of the memory taken by the chipdb, in bytes. Connections are counted as far
+    // as they are cached.
+    qint64 memorySize() const;
 
     QString name;
     coord_t width;
     coord_t height;
     QMap<QString, Package> packages;
     QMap<QString, TileBits> tilesBits;
-    QMap<QPair<coord_t, coord_t>, Tile> tiles;
-    QVector<Net> nets;
+    TileGrid<Tile> tiles;
 
-    QMap<QPair<coord_t, coord_t>, QMap<QString, net_t>> tilesNets;
+    // Where the connections of the tiles are decoded from, and cached.
+    QSharedPointer<ConnectionSource> connectionSource;
+
+    // Keyed by tile type.
+    QMap<QString, TileNetSlots> tileNetSlots;
+    NetTables netTables;
+
+    QVector<GBufIn> gbufIns;
+    QVector<GBufPin> gbufPins;
+    // Sorted by source tile, then by destination tile, by buildGlobalNetworks().
+    QVector<ColBuf> colBufs;
+
+    // Indexed by network number.
+    QVector<GlobalNetwork> globalNetworks;
+    QVector<qint32> globalNetworkColumnBuffers;
+    QVector<ColumnBuffer> columnBuffers;
+    TileGrid<qint32> tileColumnBuffers;
 
     // do we need these?
     QVector<net_t> cout;
@@ -82,6 +271,39 @@ public:
     QVector<net_t> ioin;
 };
 
-Q_DECLARE_METATYPE(ChipDB)
+// Decodes the connections of tiles on demand, and keeps the most recently used ones in a
+// cache of bounded size. Safe to use from any thread; if two threads decode the same tile at
+// once, the first result to be cached is kept.
+class ChipDB::ConnectionSource
+{
+public:
+    ConnectionSource();
+    virtual ~ConnectionSource();
+
+    QSharedPointer<const TileConnections> tileConnections(const ChipDB &db, coord_t x,
+                                                          coord_t y);
+    // This depends only on the tile type, so it is found by decoding the first tile of each
+    // type that is asked about.
+    bool drivesWhenClear(const ChipDB &db, coord_t x, coord_t y);
+
+    // In bytes.
+    qint64 cacheBudget() const;
+    void setCacheBudget(qint64 bytes);
+    qint64 cacheUsage() const;
+    // The memory taken by the source itself, such as its index, but not its cache.
+    virtual qint64 memorySize() const = 0;
+
+protected:
+    // Returns false, after reporting why, if the connections of `tile` are malformed.
+    virtual bool decode(const ChipDB &db, const Tile &tile, TileConnections *result) const = 0;
+
+private:
+    mutable QMutex _mutex;
+    QCache<int, QSharedPointer<const TileConnections>> _cache;
+    // Keyed by tile type.
+    QHash<QString, bool> _drivesWhenClear;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<const ChipDB>)
 
 #endif // CHIPDB_H
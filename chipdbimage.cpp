@@ -0,0 +1,487 @@
+#include <QtDebug>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QHash>
+#include <cstddef>
+#include <cstring>
+#include "chipdbimage.h"
+
+static const char MAGIC[8]           = {'I', 'C', 'E', 'C', 'H', 'I', 'P', '\x1a'};
+static const quint32 VERSION         = 6;
+static const quint32 BYTE_ORDER_MARK = 0x01020304;
+static const int CHECKSUM_SIZE       = 20;
+static const int SECTION_ALIGNMENT   = 8;
+
+namespace
+{
+enum SectionId {
+    StringsSection,
+    PackagesSection,
+    PinsSection,
+    TilesBitsSection,
+    FunctionsSection,
+    BitsSection,
+    TilesSection,
+    ConnectionsSection,
+    SrcNetsSection,
+    NetOffsetsSection,
+    NetSegmentsSection,
+    TileNetOffsetsSection,
+    TileNetsSection,
+    TileNetSlotsSection,
+    SlotNamesSection,
+    GBufInsSection,
+    GBufPinsSection,
+    ColBufsSection,
+    SectionCount
+};
+
+struct Section {
+    quint64 offset;
+    quint64 count;
+};
+
+// Only the header is hashed, which is cheap enough to do on every load; the sections are
+// checked for the ranges that are relied upon as they are used instead.
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint64 size;
+    ChipDBImage::Source source;
+    ChipDBImage::String name;
+    quint32 width;
+    quint32 height;
+    Section sections[SectionCount];
+    char checksum[CHECKSUM_SIZE];
+};
+}
+
+static QByteArray headerChecksum(const Header &header)
+{
+    const char *data = reinterpret_cast<const char *>(&header);
+    return QCryptographicHash::hash(QByteArray::fromRawData(data, offsetof(Header, checksum)),
+                                    QCryptographicHash::Sha1);
+}
+
+template <class T>
+static void appendSection(QByteArray &image, Section &section, const T *records, int count)
+{
+    while(image.size() % SECTION_ALIGNMENT) {
+        image.append('\0');
+    }
+
+    section.offset = image.size();
+    section.count  = count;
+    image.append(reinterpret_cast<const char *>(records), count * sizeof(T));
+}
+
+template <class T>
+static bool findSection(const uchar *data, qint64 size, const Section &section, const T **records,
+                        quint32 *count)
+{
+    if(section.offset > quint64(size) || section.count > (size - section.offset) / sizeof(T) ||
+       quintptr(data + section.offset) % alignof(T) != 0) {
+        return false;
+    }
+
+    *records = reinterpret_cast<const T *>(data + section.offset);
+    *count   = section.count;
+    return true;
+}
+
+static bool inRange(quint32 begin, quint32 end, quint32 count)
+{
+    return begin <= end && end <= count;
+}
+
+static bool isNet(net_t net, const ChipDBImage &image)
+{
+    return net >= -1 && net < qint64(image.netOffsetCount) - 1;
+}
+
+// Whether `offsets` start at 0, never decrease, and end at `end`.
+static bool isMonotonic(const quint32 *offsets, quint32 count, quint32 end)
+{
+    if(count == 0 || offsets[0] != 0 || offsets[count - 1] != end) return false;
+
+    for(quint32 index = 1; index != count; index++) {
+        if(offsets[index] < offsets[index - 1]) return false;
+    }
+    return true;
+}
+
+template <class T>
+static QVector<T> toVector(const T *begin, const T *end)
+{
+    QVector<T> result(end - begin);
+    std::copy(begin, end, result.begin());
+    return result;
+}
+
+namespace
+{
+// The connections of a chipdb image, which are used in place. Only the ranges they refer to
+// are checked when their tile is decoded.
+class ImageConnections : public ChipDB::ConnectionSource
+{
+public:
+    TileGrid<const ChipDBImage::Tile *> tiles;
+
+    ImageConnections(const ChipDBImage &image,
+                     QSharedPointer<const ChipDB::ConnectionStorage> storage)
+        : _image(image), _storage(storage)
+    {}
+
+    qint64 memorySize() const override
+    {
+        return sizeof(ImageConnections) + tiles.memorySize();
+    }
+
+protected:
+    bool decode(const ChipDB &, const ChipDB::Tile &tile,
+                ChipDB::TileConnections *result) const override
+    {
+        const ChipDBImage::Tile *record = tiles.value(tile.x, tile.y, nullptr);
+        if(!record || !isValid(*record)) {
+            qCritical() << "chipdb image has malformed connections at" << tile.x << tile.y;
+            return false;
+        }
+
+        result->connections  = _image.connections + record->buffersBegin;
+        result->buffersCount = record->buffersEnd - record->buffersBegin;
+        result->routingCount = record->routingEnd - record->routingBegin;
+        result->bits         = _image.bits;
+        result->srcNets      = _image.srcNets;
+        result->storage      = _storage;
+        return true;
+    }
+
+private:
+    ChipDBImage _image;
+    QSharedPointer<const ChipDB::ConnectionStorage> _storage;
+
+    bool isValid(const ChipDBImage::Tile &record) const
+    {
+        if(record.routingBegin != record.buffersEnd ||
+           !inRange(record.buffersBegin, record.buffersEnd, record.routingEnd) ||
+           !inRange(record.routingBegin, record.routingEnd, _image.connectionCount)) {
+            return false;
+        }
+
+        for(quint32 index = record.buffersBegin; index != record.routingEnd; index++) {
+            const ChipDBImage::Connection &conn = _image.connections[index];
+            quint32 srcNetsCount                = 1u << conn.bitsCount;
+            if(conn.bitsCount > 16 || !isNet(conn.dstNet, _image) ||
+               !inRange(conn.bitsBegin, conn.bitsBegin + conn.bitsCount, _image.bitCount) ||
+               !inRange(conn.srcNetsBegin, conn.srcNetsBegin + srcNetsCount, _image.srcNetCount)) {
+                return false;
+            }
+            for(quint32 config = 0; config != srcNetsCount; config++) {
+                if(!isNet(_image.srcNets[conn.srcNetsBegin + config], _image)) return false;
+            }
+        }
+        return true;
+    }
+};
+}
+
+ChipDBImage::ChipDBImage()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+QString ChipDBImage::string(const String &ref) const
+{
+    if(!inRange(ref.offset, ref.offset + ref.length, stringsSize)) return QString();
+    return QString::fromLatin1(strings + ref.offset, ref.length);
+}
+
+bool ChipDBImage::Source::operator==(const Source &other) const
+{
+    return size == other.size && modified == other.modified;
+}
+
+bool ChipDBImage::Source::operator!=(const Source &other) const
+{
+    return !(*this == other);
+}
+
+ChipDBImage::Source ChipDBImage::sourceOf(const QFileInfo &file)
+{
+    return Source{quint64(file.size()), file.lastModified().toMSecsSinceEpoch()};
+}
+
+QByteArray ChipDBImage::serialize(const ChipDB &db, const Source &source)
+{
+    QByteArray strings;
+    QHash<QString, String> interned;
+    auto intern = [&](const QString &value) -> String {
+        auto it = interned.constFind(value);
+        if(it != interned.constEnd()) return *it;
+
+        QByteArray latin1 = value.toLatin1();
+        String ref{quint32(strings.size()), quint32(latin1.size())};
+        strings.append(latin1);
+        interned.insert(value, ref);
+        return ref;
+    };
+
+    QVector<Package> packages;
+    QVector<Pin> pins;
+    for(const ChipDB::Package &package : db.packages) {
+        Package record{intern(package.name), quint32(pins.size()), 0};
+        for(const ChipDB::Pin &pin : package.pins) {
+            pins.append(Pin{intern(pin.name), pin.net, pin.tileX, pin.tileY, 0});
+        }
+        record.pinsEnd = pins.size();
+        packages.append(record);
+    }
+
+    QVector<nbit_t> bits;
+    QVector<TileBits> tilesBits;
+    QVector<Function> functions;
+    for(const ChipDB::TileBits &tileBits : db.tilesBits) {
+        TileBits record{intern(tileBits.type), tileBits.columns, tileBits.rows,
+                        quint32(functions.size()), 0};
+        for(auto it = tileBits.functions.begin(); it != tileBits.functions.end(); ++it) {
+            functions.append(Function{intern(it.key()), quint32(bits.size()), 0});
+            bits += *it;
+            functions.last().bitsEnd = bits.size();
+        }
+        record.functionsEnd = functions.size();
+        tilesBits.append(record);
+    }
+
+    // The connections are stored tile by tile, with their bits after the function bits.
+    QVector<Connection> connections;
+    QVector<net_t> srcNets;
+    QVector<Tile> tiles;
+    for(const ChipDB::Tile &tile : db.tiles) {
+        Tile record{intern(tile.type), tile.x, tile.y, 0, 0, 0, 0};
+
+        QSharedPointer<const ChipDB::TileConnections> tileConnections =
+            db.tileConnections(tile.x, tile.y);
+        if(!tileConnections) return QByteArray();
+
+        record.buffersBegin = connections.size();
+        for(quint32 index = 0;
+            index != tileConnections->buffersCount + tileConnections->routingCount; index++) {
+            const ChipDB::Connection &conn = tileConnections->connections[index];
+            connections.append(Connection{conn.dstNet, quint32(bits.size()), conn.bitsCount,
+                                          quint32(srcNets.size())});
+            for(quint32 bit = 0; bit != conn.bitsCount; bit++) {
+                bits.append(tileConnections->bits[conn.bitsBegin + bit]);
+            }
+            for(quint32 config = 0; config != 1u << conn.bitsCount; config++) {
+                srcNets.append(tileConnections->srcNet(index, config));
+            }
+        }
+        record.buffersEnd   = record.buffersBegin + tileConnections->buffersCount;
+        record.routingBegin = record.buffersEnd;
+        record.routingEnd   = connections.size();
+        tiles.append(record);
+    }
+
+    // The slot tables are stored in the order of their types, like the tile bits.
+    QVector<TileNetSlots> tileNetSlots;
+    QVector<String> slotNames;
+    for(auto it = db.tileNetSlots.begin(); it != db.tileNetSlots.end(); ++it) {
+        TileNetSlots record{intern(it.key()), quint32(slotNames.size()), 0};
+        for(const QString &slotName : it->names) {
+            slotNames.append(intern(slotName));
+        }
+        record.slotNamesEnd = slotNames.size();
+        tileNetSlots.append(record);
+    }
+
+    const ChipDB::NetTables &netTables = db.netTables;
+    quint32 tileCount                  = quint32(db.width) * db.height;
+    quint32 segmentCount = netTables.netCount ? netTables.offsets[netTables.netCount] : 0;
+    quint32 tileNetCount = netTables.tileOffsets ? netTables.tileOffsets[tileCount] : 0;
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version   = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.source    = source;
+    header.name      = intern(db.name);
+    header.width  = db.width;
+    header.height = db.height;
+
+    QByteArray image(sizeof(Header), '\0');
+    appendSection(image, header.sections[StringsSection], strings.constData(), strings.size());
+    appendSection(image, header.sections[PackagesSection], packages.constData(), packages.size());
+    appendSection(image, header.sections[PinsSection], pins.constData(), pins.size());
+    appendSection(image, header.sections[TilesBitsSection], tilesBits.constData(),
+                  tilesBits.size());
+    appendSection(image, header.sections[FunctionsSection], functions.constData(),
+                  functions.size());
+    appendSection(image, header.sections[BitsSection], bits.constData(), bits.size());
+    appendSection(image, header.sections[TilesSection], tiles.constData(), tiles.size());
+    appendSection(image, header.sections[ConnectionsSection], connections.constData(),
+                  connections.size());
+    appendSection(image, header.sections[SrcNetsSection], srcNets.constData(), srcNets.size());
+    appendSection(image, header.sections[NetOffsetsSection], netTables.offsets,
+                  netTables.offsets ? netTables.netCount + 1 : 0);
+    appendSection(image, header.sections[NetSegmentsSection], netTables.segments, segmentCount);
+    appendSection(image, header.sections[TileNetOffsetsSection], netTables.tileOffsets,
+                  netTables.tileOffsets ? tileCount + 1 : 0);
+    appendSection(image, header.sections[TileNetsSection], netTables.tileNets, tileNetCount);
+    appendSection(image, header.sections[TileNetSlotsSection], tileNetSlots.constData(),
+                  tileNetSlots.size());
+    appendSection(image, header.sections[SlotNamesSection], slotNames.constData(),
+                  slotNames.size());
+    appendSection(image, header.sections[GBufInsSection], db.gbufIns.constData(),
+                  db.gbufIns.size());
+    appendSection(image, header.sections[GBufPinsSection], db.gbufPins.constData(),
+                  db.gbufPins.size());
+    appendSection(image, header.sections[ColBufsSection], db.colBufs.constData(),
+                  db.colBufs.size());
+
+    header.size = image.size();
+    memcpy(header.checksum, headerChecksum(header).constData(), CHECKSUM_SIZE);
+
+    memcpy(image.data(), &header, sizeof(Header));
+    return image;
+}
+
+bool ChipDBImage::load(const uchar *data, qint64 size)
+{
+    if(size < qint64(sizeof(Header)) || quintptr(data) % alignof(Header) != 0) return false;
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+       header->byteOrder != BYTE_ORDER_MARK || header->size != quint64(size)) {
+        return false;
+    }
+
+    if(headerChecksum(*header) != QByteArray::fromRawData(header->checksum, CHECKSUM_SIZE)) {
+        qWarning() << "chipdb image is corrupted";
+        return false;
+    }
+
+    source = header->source;
+    name   = header->name;
+    width  = header->width;
+    height = header->height;
+
+    const Section *sections = header->sections;
+    return findSection(data, size, sections[StringsSection], &strings, &stringsSize) &&
+           findSection(data, size, sections[PackagesSection], &packages, &packageCount) &&
+           findSection(data, size, sections[PinsSection], &pins, &pinCount) &&
+           findSection(data, size, sections[TilesBitsSection], &tilesBits, &tileBitsCount) &&
+           findSection(data, size, sections[FunctionsSection], &functions, &functionCount) &&
+           findSection(data, size, sections[BitsSection], &bits, &bitCount) &&
+           findSection(data, size, sections[TilesSection], &tiles, &tileCount) &&
+           findSection(data, size, sections[ConnectionsSection], &connections,
+                       &connectionCount) &&
+           findSection(data, size, sections[SrcNetsSection], &srcNets, &srcNetCount) &&
+           findSection(data, size, sections[NetOffsetsSection], &netOffsets, &netOffsetCount) &&
+           findSection(data, size, sections[NetSegmentsSection], &netSegments,
+                       &netSegmentCount) &&
+           findSection(data, size, sections[TileNetOffsetsSection], &tileNetOffsets,
+                       &tileNetOffsetCount) &&
+           findSection(data, size, sections[TileNetsSection], &tileNets, &tileNetCount) &&
+           findSection(data, size, sections[TileNetSlotsSection], &tileNetSlots,
+                       &tileNetSlotsCount) &&
+           findSection(data, size, sections[SlotNamesSection], &slotNames, &slotNameCount) &&
+           findSection(data, size, sections[GBufInsSection], &gbufIns, &gbufInCount) &&
+           findSection(data, size, sections[GBufPinsSection], &gbufPins, &gbufPinCount) &&
+           findSection(data, size, sections[ColBufsSection], &colBufs, &colBufCount);
+}
+
+bool ChipDBImage::toChipDB(ChipDB *db,
+                           QSharedPointer<const ChipDB::ConnectionStorage> storage) const
+{
+    // The net tables are used in place, once the offsets that index them are known to be in
+    // range; every net they hold is checked, since nets index the tables of bitstreams.
+    if(netOffsetCount == 0 || !isMonotonic(netOffsets, netOffsetCount, netSegmentCount) ||
+       tileNetOffsetCount != width * height + 1 ||
+       !isMonotonic(tileNetOffsets, tileNetOffsetCount, tileNetCount)) {
+        return false;
+    }
+    for(quint32 index = 0; index != tileNetCount; index++) {
+        if(!isNet(tileNets[index], *this)) return false;
+    }
+
+    db->name   = string(name);
+    db->width  = width;
+    db->height = height;
+
+    for(const Package *package = packages; package != packages + packageCount; package++) {
+        if(!inRange(package->pinsBegin, package->pinsEnd, pinCount)) return false;
+
+        ChipDB::Package result;
+        result.name = string(package->name);
+        for(quint32 index = package->pinsBegin; index != package->pinsEnd; index++) {
+            const Pin &pin = pins[index];
+            if(!isNet(pin.net, *this)) return false;
+
+            ChipDB::Pin resultPin{string(pin.name), pin.tileX, pin.tileY, pin.net};
+            result.pins[resultPin.name] = resultPin;
+        }
+        db->packages[result.name] = result;
+    }
+
+    for(const TileBits *tileBits = tilesBits; tileBits != tilesBits + tileBitsCount; tileBits++) {
+        if(!inRange(tileBits->functionsBegin, tileBits->functionsEnd, functionCount)) {
+            return false;
+        }
+
+        ChipDB::TileBits result;
+        result.type    = string(tileBits->type);
+        result.columns = tileBits->columns;
+        result.rows    = tileBits->rows;
+        for(quint32 index = tileBits->functionsBegin; index != tileBits->functionsEnd; index++) {
+            const Function &function = functions[index];
+            if(!inRange(function.bitsBegin, function.bitsEnd, bitCount)) return false;
+
+            result.functions[string(function.name)] =
+                toVector(bits + function.bitsBegin, bits + function.bitsEnd);
+        }
+        db->tilesBits[result.type] = result;
+    }
+
+    QSharedPointer<ImageConnections> source(new ImageConnections(*this, storage));
+    TileGrid<const Tile *> &tilesByCoords = source->tiles;
+    tilesByCoords.resize(db->width, db->height);
+    db->tiles.resize(db->width, db->height);
+    for(const Tile *tile = tiles; tile != tiles + tileCount; tile++) {
+        tilesByCoords.insert(tile->x, tile->y, tile);
+
+        ChipDB::Tile &result = db->tile(tile->x, tile->y);
+        result.x             = tile->x;
+        result.y             = tile->y;
+        result.type          = string(tile->type);
+    }
+    db->connectionSource = source;
+
+    for(const TileNetSlots *layout = tileNetSlots; layout != tileNetSlots + tileNetSlotsCount;
+        layout++) {
+        if(!inRange(layout->slotNamesBegin, layout->slotNamesEnd, slotNameCount)) return false;
+
+        ChipDB::TileNetSlots &result = db->tileNetSlots[string(layout->type)];
+        for(quint32 index = layout->slotNamesBegin; index != layout->slotNamesEnd; index++) {
+            QString slotName = string(slotNames[index]);
+            result.slotOf.insert(slotName, result.names.size());
+            result.names.append(slotName);
+        }
+    }
+
+    ChipDB::NetTables &netTables = db->netTables;
+    netTables.netCount           = netOffsetCount - 1;
+    netTables.offsets            = netOffsets;
+    netTables.segments           = netSegments;
+    netTables.tileOffsets        = tileNetOffsets;
+    netTables.tileNets           = tileNets;
+    netTables.storage            = storage;
+
+    db->gbufIns  = toVector(gbufIns, gbufIns + gbufInCount);
+    db->gbufPins = toVector(gbufPins, gbufPins + gbufPinCount);
+    db->colBufs  = toVector(colBufs, colBufs + colBufCount);
+    db->buildGlobalNetworks();
+    db->buildExtractPlans();
+    return true;
+}
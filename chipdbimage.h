@@ -0,0 +1,153 @@
+#ifndef CHIPDBIMAGE_H
+#define CHIPDBIMAGE_H
+
+#include <QByteArray>
+#include <QFileInfo>
+#include "chipdb.h"
+
+// A flat representation of a ChipDB that can be used directly from a memory map.
+//
+// All records have a fixed size and refer to each other by indexes into other arrays
+// instead of pointers. Strings are stored once in a shared pool, and bits (of tile bit
+// functions and of connections) and source nets of connections are stored in shared pools.
+// The connections and net tables are stored exactly like in the chipdb, which uses them in
+// place; only the ranges it relies on are checked.
+class ChipDBImage
+{
+public:
+    // Identifies the chipdb an image was serialized from by its size and modification time,
+    // so that a stale image is noticed without reading the chipdb.
+    struct Source {
+        quint64 size;
+        qint64 modified;
+
+        bool operator==(const Source &other) const;
+        bool operator!=(const Source &other) const;
+    };
+    struct String {
+        quint32 offset;
+        quint32 length;
+    };
+
+    struct Package {
+        String name;
+        quint32 pinsBegin;
+        quint32 pinsEnd;
+    };
+
+    struct Pin {
+        String name;
+        qint32 net;
+        coord_t tileX;
+        coord_t tileY;
+        quint16 reserved;
+    };
+
+    struct TileBits {
+        String type;
+        quint16 columns;
+        quint16 rows;
+        quint32 functionsBegin;
+        quint32 functionsEnd;
+    };
+
+    struct Function {
+        String name;
+        quint32 bitsBegin;
+        quint32 bitsEnd;
+    };
+
+    // The buffers of a tile are followed directly by its routing switches.
+    struct Tile {
+        String type;
+        coord_t x;
+        coord_t y;
+        quint32 buffersBegin;
+        quint32 buffersEnd;
+        quint32 routingBegin;
+        quint32 routingEnd;
+    };
+
+    // Connections are stored exactly like in the chipdb, so that it can use them in place.
+    typedef ChipDB::Connection Connection;
+    typedef ChipDB::GBufIn GBufIn;
+    typedef ChipDB::GBufPin GBufPin;
+    typedef ChipDB::ColBuf ColBuf;
+
+    typedef ChipDB::NetSegment NetSegment;
+
+    // The names of the slots of the nets local to tiles of type `type` are
+    // slotNames[slotNamesBegin] up to slotNames[slotNamesEnd].
+    struct TileNetSlots {
+        String type;
+        quint32 slotNamesBegin;
+        quint32 slotNamesEnd;
+    };
+
+    Source source;
+    String name;
+    quint32 width;
+    quint32 height;
+
+    const char *strings;
+    quint32 stringsSize;
+    const Package *packages;
+    quint32 packageCount;
+    const Pin *pins;
+    quint32 pinCount;
+    const TileBits *tilesBits;
+    quint32 tileBitsCount;
+    const Function *functions;
+    quint32 functionCount;
+    const nbit_t *bits;
+    quint32 bitCount;
+    const Tile *tiles;
+    quint32 tileCount;
+    const Connection *connections;
+    quint32 connectionCount;
+    const net_t *srcNets;
+    quint32 srcNetCount;
+    // Like ChipDB::NetTables.
+    const quint32 *netOffsets;
+    quint32 netOffsetCount;
+    const NetSegment *netSegments;
+    quint32 netSegmentCount;
+    const quint32 *tileNetOffsets;
+    quint32 tileNetOffsetCount;
+    const net_t *tileNets;
+    quint32 tileNetCount;
+    const TileNetSlots *tileNetSlots;
+    quint32 tileNetSlotsCount;
+    const String *slotNames;
+    quint32 slotNameCount;
+    const GBufIn *gbufIns;
+    quint32 gbufInCount;
+    const GBufPin *gbufPins;
+    quint32 gbufPinCount;
+    const ColBuf *colBufs;
+    quint32 colBufCount;
+
+    ChipDBImage();
+
+    // Point this image at the arrays in a serialized image, after checking that it has
+    // a compatible version and an intact header. Whether it is stale is up to the caller, by
+    // comparing `source`.
+    bool load(const uchar *data, qint64 size);
+    // Point this image at the image compiled into the executable for `device`, if any, in
+    // place. These are serialized from chipdb/chipdb-*.txt by tools/chipdbgen at build time.
+    bool loadBuiltin(const QString &device);
+    // The connections of `db` are decoded from this image as their tiles are used, and they
+    // and the net tables point into it; `storage` (if any) is kept alive by `db` to keep them
+    // valid. Returns false if the ranges of the net tables are malformed.
+    bool toChipDB(ChipDB *db,
+                  QSharedPointer<const ChipDB::ConnectionStorage> storage = nullptr) const;
+
+    // Returns an empty array if the connections of a tile of `db` cannot be decoded.
+    static QByteArray serialize(const ChipDB &db, const Source &source = Source());
+    static Source sourceOf(const QFileInfo &file);
+
+private:
+    QString string(const String &ref) const;
+};
+
+#endif // CHIPDBIMAGE_H
@@ -1,17 +1,156 @@
+#include <QtDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include "chipdbloader.h"
+#include "chipdbimage.h"
+#include "gzipdevice.h"
 
-ChipDBLoader::ChipDBLoader(QObject *parent, QString device) : QThread(parent), _device(device)
+ChipDBLoader::ChipDBLoader(QObject *parent, QString device, QStringList searchPaths)
+    : QThread(parent), _device(device), _searchPaths(searchPaths)
 {}
 
+QString ChipDBLoader::device() const
+{
+    return _device;
+}
+
+const LoadProgress &ChipDBLoader::progress() const
+{
+    return _progress;
+}
+
+void ChipDBLoader::abort()
+{
+    _progress.cancel();
+}
+
+static QString cachePath(const QString &device)
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(cacheDir.isEmpty()) return QString();
+
+    return cacheDir + "/chipdb-" + device + ".bin";
+}
+
+namespace {
+// Keeps a chipdb cache mapped for as long as a chipdb uses its connections in place.
+struct MappedImage : ChipDB::ConnectionStorage {
+    QFile file;
+    uchar *data;
+
+    explicit MappedImage(const QString &path) : file(path), data(nullptr)
+    {}
+
+    ~MappedImage()
+    {
+        if(data) file.unmap(data);
+    }
+};
+}
+
+static bool loadCache(const QString &path, const ChipDBImage::Source &source, ChipDB *db)
+{
+    QSharedPointer<MappedImage> mapped(new MappedImage(path));
+    if(!mapped->file.open(QIODevice::ReadOnly)) return false;
+
+    mapped->data = mapped->file.map(0, mapped->file.size());
+    if(!mapped->data) return false;
+
+    ChipDBImage image;
+    return image.load(mapped->data, mapped->file.size()) && image.source == source &&
+           image.toChipDB(db, mapped);
+}
+
+static void saveCache(const QString &path, const ChipDBImage::Source &source, const ChipDB &db)
+{
+    QByteArray image = ChipDBImage::serialize(db, source);
+    if(image.isEmpty()) return;
+
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly) || file.write(image) < 0 || !file.commit()) {
+        qWarning() << "cannot write chipdb cache" << path << file.errorString();
+    }
+}
+
+static QString findChipDB(const QString &device, const QStringList &searchPaths)
+{
+    for(const QString &dir : searchPaths) {
+        // Either plain or compressed.
+        for(const QString &fileName :
+            {"chipdb-" + device + ".txt", "chipdb-" + device + ".txt.gz"}) {
+            QString path = dir + "/" + fileName;
+            if(QFileInfo(path).isFile()) return path;
+        }
+    }
+    return QString();
+}
+
 void ChipDBLoader::run()
 {
-    QFile file(":/chipdb/" + _device + ".txt");
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
+    ChipDBImage builtin;
+    if(builtin.loadBuiltin(_device)) {
+        QSharedPointer<ChipDB> db(new ChipDB);
+        if(builtin.toChipDB(db.data())) {
+            emit ready(db);
+        } else {
+            emit failed();
+        }
+        return;
+    }
+
+    QString fileName = findChipDB(_device, _searchPaths);
+    if(fileName.isEmpty()) {
+        qCritical() << "no chipdb for device" << _device;
+        emit failed();
+        return;
+    }
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "cannot open" << fileName << file.errorString();
+        emit failed();
+        return;
+    }
+
+    ChipDBImage::Source source = ChipDBImage::sourceOf(QFileInfo(file));
+    QString path               = cachePath(_device);
+    if(!path.isEmpty()) {
+        QSharedPointer<ChipDB> db(new ChipDB);
+        if(loadCache(path, source, db.data())) {
+            emit ready(db);
+            return;
+        }
+    }
+
+    // A compressed chipdb is decompressed into memory before it is parsed in chunks, and its
+    // progress is reported against the compressed bytes consumed, like for bitstreams.
+    GzipDevice gzip(&file);
+    QIODevice *in = &file;
+    if(GzipDevice::isCompressed(&file)) {
+        gzip.open(QIODevice::ReadOnly);
+        in = &gzip;
+    }
+
+    auto reportProgress = [&](int cur, int max) {
+        if(in == &gzip) {
+            return _progress.update(file.pos(), file.size());
+        } else {
+            return _progress.update(cur, max);
+        }
+    };
+
+    QSharedPointer<ChipDB> db(new ChipDB);
+    db->name = _device;
+    bool ok  = db->parse(in, reportProgress, ChipDB::ParallelParse);
+    if(_progress.isCancelled()) return;
 
-    ChipDB db;
-    db.name = _device;
-    if(db.parse(&file, [=](int cur, int max) { emit progress(cur, max); })) {
+    if(ok) {
+        if(!path.isEmpty()) saveCache(path, source, *db);
         emit ready(db);
     } else {
         emit failed();
@@ -3,24 +3,33 @@
 
 #include <functional>
 
+#include <QStringList>
 #include <QThread>
 #include <QString>
 #include "chipdb.h"
+#include "loadprogress.h"
 
 class ChipDBLoader : public QThread
 {
     Q_OBJECT
 public:
-    ChipDBLoader(QObject *parent, QString name);
+    // Loads the builtin chipdb of `device`, or else the first one found in `searchPaths`.
+    ChipDBLoader(QObject *parent, QString device, QStringList searchPaths);
+
+    QString device() const;
+    const LoadProgress &progress() const;
+    // Stop parsing as soon as possible. Neither ready() nor failed() are emitted afterwards.
+    void abort();
 
 private:
     QString _device;
+    QStringList _searchPaths;
+    LoadProgress _progress;
 
     void run() override;
 
 signals:
-    void progress(int cur, int max);
-    void ready(ChipDB chipDB);
+    void ready(QSharedPointer<const ChipDB> chipDB);
     void failed();
 };
 
@@ -0,0 +1,162 @@
+#include <QtDebug>
+#include <QDir>
+#include <QStandardPaths>
+#include "chipdbregistry.h"
+#include "chipdbloader.h"
+
+static const qint64 DEFAULT_MEMORY_BUDGET = 256 << 20;
+
+ChipDBRegistry::ChipDBRegistry(QObject *parent)
+    : QObject(parent), _searchPaths(defaultSearchPaths()), _memoryBudget(DEFAULT_MEMORY_BUDGET),
+      _memoryUsage(0)
+{
+    QByteArray budget = qgetenv("ICEFLOORPLAN_CHIPDB_BUDGET");
+    if(!budget.isEmpty()) {
+        bool ok;
+        qint64 megabytes = budget.toLongLong(&ok);
+        if(ok && megabytes >= 0) {
+            _memoryBudget = megabytes << 20;
+        } else {
+            qWarning() << "invalid chipdb memory budget" << budget;
+        }
+    }
+}
+
+QStringList ChipDBRegistry::defaultSearchPaths()
+{
+    QStringList paths;
+    QString extraPaths = QString::fromLocal8Bit(qgetenv("ICEFLOORPLAN_CHIPDB_PATH"));
+    for(const QString &dir : extraPaths.split(QDir::listSeparator())) {
+        if(!dir.isEmpty()) paths.append(dir);
+    }
+    for(const QString &dir : QStandardPaths::standardLocations(QStandardPaths::AppDataLocation)) {
+        paths.append(dir + "/chipdb");
+    }
+    // Where IceStorm installs its chipdbs.
+    for(const QString &dir :
+        QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation)) {
+        paths.append(dir + "/icebox");
+    }
+    return paths;
+}
+
+QStringList ChipDBRegistry::searchPaths() const
+{
+    return _searchPaths;
+}
+
+void ChipDBRegistry::setSearchPaths(const QStringList &paths)
+{
+    _searchPaths = paths;
+}
+
+qint64 ChipDBRegistry::memoryBudget() const
+{
+    return _memoryBudget;
+}
+
+void ChipDBRegistry::setMemoryBudget(qint64 bytes)
+{
+    _memoryBudget = bytes;
+    evict();
+}
+
+qint64 ChipDBRegistry::memoryUsage() const
+{
+    return _memoryUsage;
+}
+
+QSharedPointer<const ChipDB> ChipDBRegistry::find(const QString &device)
+{
+    auto it = _chipDBs.find(device);
+    if(it == _chipDBs.end()) return nullptr;
+
+    _recentlyUsed.removeOne(device);
+    _recentlyUsed.append(device);
+    return it->chipDB;
+}
+
+void ChipDBRegistry::request(const QString &device)
+{
+    auto it = _loads.find(device);
+    if(it != _loads.end()) {
+        // If the load was aborted, it is started again once its worker has finished.
+        it->requests++;
+        return;
+    }
+
+    _loads.insert(device, Load{nullptr, 1});
+    startLoad(device);
+}
+
+void ChipDBRegistry::startLoad(const QString &device)
+{
+    ChipDBLoader *loader = new ChipDBLoader(this, device, _searchPaths);
+    connect(loader, &QThread::finished, loader, &QObject::deleteLater);
+    _loads[device].loader = loader;
+
+    // An aborted load emits neither ready() nor failed(), and is only dropped once it has
+    // finished, so that requests meanwhile don't start a second load of the same device.
+    connect(loader, &QThread::finished, this, [=] {
+        auto it = _loads.find(device);
+        if(it == _loads.end() || it->loader != loader) return;
+
+        if(it->requests > 0) {
+            startLoad(device);
+        } else {
+            _loads.erase(it);
+        }
+    });
+    connect(loader, &ChipDBLoader::ready, this, [=](QSharedPointer<const ChipDB> chipDB) {
+        if(_loads.value(device).loader != loader) return;
+
+        _loads.remove(device);
+        insert(device, chipDB);
+        emit ready(device, chipDB);
+    });
+    connect(loader, &ChipDBLoader::failed, this, [=] {
+        if(_loads.value(device).loader != loader) return;
+
+        _loads.remove(device);
+        emit failed(device);
+    });
+
+    loader->start();
+}
+
+void ChipDBRegistry::cancel(const QString &device)
+{
+    auto it = _loads.find(device);
+    if(it == _loads.end() || it->requests == 0 || --it->requests > 0) return;
+
+    if(it->loader) {
+        it->loader->abort();
+    }
+}
+
+const LoadProgress *ChipDBRegistry::progress(const QString &device) const
+{
+    ChipDBLoader *loader = _loads.value(device).loader;
+    return loader ? &loader->progress() : nullptr;
+}
+
+void ChipDBRegistry::insert(const QString &device, QSharedPointer<const ChipDB> chipDB)
+{
+    // Measured once, since it walks every tile of the chipdb.
+    Entry entry{chipDB, chipDB->memorySize()};
+    if(_chipDBs.contains(device)) _memoryUsage -= _chipDBs[device].size;
+    _memoryUsage += entry.size;
+    _chipDBs.insert(device, entry);
+    _recentlyUsed.removeOne(device);
+    _recentlyUsed.append(device);
+    evict();
+}
+
+void ChipDBRegistry::evict()
+{
+    // The most recently used chipdb is always kept, even if it alone exceeds the budget.
+    while(_recentlyUsed.size() > 1 && memoryUsage() > _memoryBudget) {
+        QString device = _recentlyUsed.takeFirst();
+        _memoryUsage -= _chipDBs.take(device).size;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef CHIPDBREGISTRY_H
+#define CHIPDBREGISTRY_H
+
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include "chipdb.h"
+#include "loadprogress.h"
+
+class ChipDBLoader;
+
+// Loads the chipdbs of devices on demand, and keeps the recently used ones in memory.
+//
+// Requests for a device that is already loading share that load. Once the chipdbs kept
+// exceed the memory budget, the least recently used ones are dropped from the registry; any
+// still in use elsewhere are freed when their last user releases them.
+class ChipDBRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ChipDBRegistry(QObject *parent = nullptr);
+
+    // The installed chipdb directories, and the IceStorm ones, after those listed in the
+    // ICEFLOORPLAN_CHIPDB_PATH environment variable.
+    static QStringList defaultSearchPaths();
+    QStringList searchPaths() const;
+    void setSearchPaths(const QStringList &paths);
+
+    // In bytes. Defaults to the ICEFLOORPLAN_CHIPDB_BUDGET environment variable, in MiB.
+    qint64 memoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+    // The sum of the sizes of the chipdbs kept, as measured when each was loaded.
+    qint64 memoryUsage() const;
+
+    // Returns the chipdb of `device` if it is loaded, and marks it as recently used.
+    QSharedPointer<const ChipDB> find(const QString &device);
+    // Start loading the chipdb of `device`, unless it is already loading. Either ready()
+    // or failed() is emitted once it is done.
+    void request(const QString &device);
+    // Withdraw a request. The load is aborted once no requests for it are left; requests made
+    // before the aborted load has finished restart it then.
+    void cancel(const QString &device);
+    // Returns null if `device` isn't loading.
+    const LoadProgress *progress(const QString &device) const;
+
+signals:
+    void ready(QString device, QSharedPointer<const ChipDB> chipDB);
+    void failed(QString device);
+
+private:
+    struct Entry {
+        QSharedPointer<const ChipDB> chipDB;
+        qint64 size;
+    };
+
+    // A load whose requests were all withdrawn is aborted, but kept until it has finished.
+    struct Load {
+        QPointer<ChipDBLoader> loader;
+        int requests;
+    };
+
+    QStringList _searchPaths;
+    qint64 _memoryBudget;
+    QMap<QString, Entry> _chipDBs;
+    qint64 _memoryUsage;
+    // The loaded devices, least recently used first.
+    QStringList _recentlyUsed;
+    QMap<QString, Load> _loads;
+
+    void startLoad(const QString &device);
+    void insert(const QString &device, QSharedPointer<const ChipDB> chipDB);
+    void evict();
+};
+
+#endif // CHIPDBREGISTRY_H
@@ -3,8 +3,7 @@
 #include <QGraphicsPathItem>
 #include "circuitbuilder.h"
 
-CircuitBuilder::CircuitBuilder(QGraphicsItem *parent)
-    : _pen(Qt::black), _font("fixed"), _parent(parent)
+CircuitBuilder::CircuitBuilder(QVector<Part> *parts) : _pen(Qt::black), _parts(parts)
 {
     _pen.setCapStyle(Qt::FlatCap);
     setGrid(20);
@@ -13,7 +12,6 @@ CircuitBuilder::CircuitBuilder(QGraphicsItem *parent)
 void CircuitBuilder::setGrid(qreal grid)
 {
     _grid = grid;
-    _font.setPixelSize(grid * 0.7);
 }
 
 void CircuitBuilder::setColor(const QColor &color)
@@ -26,25 +24,83 @@ void CircuitBuilder::setOrigin(qreal x, qreal y)
     _origin = QPointF(x, y);
 }
 
-QGraphicsPathItem *CircuitBuilder::build(const QString &toolTip, net_t net)
+void CircuitBuilder::build(const QString &toolTip, net_t net)
 {
-    if(_path.isEmpty() && _textPath.isEmpty()) return nullptr;
-
-    QGraphicsPathItem *item = new QGraphicsPathItem(_parent);
-    item->setPath(_path);
-    item->setPen(_pen);
-    item->setToolTip(toolTip);
-    if(net != -1) {
-        item->setData(0, net);
+    if(_path.isEmpty() && _texts.isEmpty()) return;
+
+    _parts->append(Part{_path, _pen, _grid, toolTip, net, _texts});
+
+    _path = QPainterPath();
+    _texts.clear();
+}
+
+static QPainterPath layoutLabel(const QFont &font, qreal grid,
+                                const CircuitBuilder::Part::Text &label)
+{
+    QFontMetrics metrics(font);
+    QRect bounds;
+    if(label.anchor == CircuitBuilder::Left || label.anchor == CircuitBuilder::Right) {
+        bounds = metrics.boundingRect(label.text);
+    } else {
+        bounds = metrics.tightBoundingRect(label.text);
+    }
+
+    QPainterPath labelPath;
+    labelPath.addText(-bounds.width() / 2, metrics.ascent() / 2, font, label.text);
+    if(label.anchor == CircuitBuilder::Left) {
+        labelPath.translate(0.2 * grid + bounds.width() / 2, 0.5 * grid);
+    } else if(label.anchor == CircuitBuilder::Right) {
+        labelPath.translate(0.8 * grid - bounds.width() / 2, 0.5 * grid);
+    } else {
+        labelPath.translate(0.5 * grid, 0.5 * grid);
+    }
+    return labelPath.translated(QPointF(-1, -1) + label.pos * grid);
+}
+
+static QPainterPath layoutText(QFont font, qreal grid, const CircuitBuilder::Part::Text &text)
+{
+    QString lines = text.text;
+    font.setPixelSize(font.pixelSize() * text.size);
+    if(lines[0] == '~') {
+        font.setOverline(true);
+        lines = lines.mid(1);
+    }
+    QFontMetrics metrics(font);
+
+    QPoint pos;
+    QPainterPath textPath;
+    for(QString line : lines.split("\n")) {
+        textPath.addText(pos, font, line);
+        pos = pos + QPoint(0, metrics.lineSpacing());
+    }
+
+    QRectF bounds = textPath.boundingRect();
+    textPath.translate(-bounds.x() - bounds.width() / 2, -bounds.y() - bounds.height() / 2);
+    return textPath.translated(QPointF(-1, -1) + text.pos * grid);
+}
+
+QGraphicsPathItem *CircuitBuilder::createItem(const Part &part, QGraphicsItem *parent)
+{
+    QGraphicsPathItem *item = new QGraphicsPathItem(parent);
+    item->setPath(part.path);
+    item->setPen(part.pen);
+    item->setToolTip(part.toolTip);
+    if(part.net != -1) {
+        item->setData(0, part.net);
+    }
+
+    QFont font("fixed");
+    font.setPixelSize(part.grid * 0.7);
+    QPainterPath textPath;
+    for(const Part::Text &text : part.texts) {
+        textPath.addPath(text.isLabel ? layoutLabel(font, part.grid, text)
+                                      : layoutText(font, part.grid, text));
     }
 
     QGraphicsPathItem *textItem = new QGraphicsPathItem(item);
-    textItem->setPath(_textPath);
+    textItem->setPath(textPath);
     textItem->setPen(Qt::NoPen);
-    textItem->setBrush(_pen.brush());
-
-    _path     = QPainterPath();
-    _textPath = QPainterPath();
+    textItem->setBrush(part.pen.brush());
     return item;
 }
 
@@ -227,46 +283,10 @@ void CircuitBuilder::addClockSymbol(CircuitBuilder::Direction dir, qreal x, qrea
 void CircuitBuilder::addLabel(CircuitBuilder::Direction anchor, qreal x, qreal y,
                               const QString &text)
 {
-    QFontMetrics metrics(_font);
-    QRect bounds;
-    if(anchor == Left || anchor == Right) {
-        bounds = metrics.boundingRect(text);
-    } else {
-        bounds = metrics.tightBoundingRect(text);
-    }
-
-    QPainterPath labelPath;
-    labelPath.addText(-bounds.width() / 2, metrics.ascent() / 2, _font, text);
-    if(anchor == Left) {
-        labelPath.translate((x + 0.2) * _grid + bounds.width() / 2, (y + 0.5) * _grid);
-    } else if(anchor == Right) {
-        labelPath.translate((x + 0.8) * _grid - bounds.width() / 2, (y + 0.5) * _grid);
-    } else {
-        labelPath.translate((x + 0.5) * _grid, (y + 0.5) * _grid);
-    }
-    _textPath.addPath(labelPath.translated(QPointF(-1, -1) + _origin * _grid));
+    _texts.append(Part::Text{true, anchor, _origin + QPointF(x, y), text, 1});
 }
 
 void CircuitBuilder::addText(qreal x, qreal y, QString text, qreal size)
 {
-    QFont font = _font;
-    font.setPixelSize(font.pixelSize() * size);
-    if(text[0] == '~') {
-        font.setOverline(true);
-        text = text.mid(1);
-    }
-    QFontMetrics metrics(font);
-
-    QPoint pos;
-    QPainterPath textPath;
-    QStringList lines = text.split("\n");
-    for(QString line : lines) {
-        textPath.addText(pos, font, line);
-        pos = pos + QPoint(0, metrics.lineSpacing());
-    }
-
-    QRectF bounds = textPath.boundingRect();
-    textPath.translate(-bounds.x() - bounds.width() / 2, -bounds.y() - bounds.height() / 2);
-    bounds = textPath.boundingRect();
-    _textPath.addPath(textPath.translated(QPointF(-1, -1) + (_origin + QPointF(x, y)) * _grid));
+    _texts.append(Part::Text{false, Up, _origin + QPointF(x, y), text, size});
 }
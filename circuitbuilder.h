@@ -1,9 +1,9 @@
 #ifndef CIRCUITBUILDER_H
 #define CIRCUITBUILDER_H
 
-#include <QFont>
 #include <QPainterPath>
 #include <QPen>
+#include <QVector>
 #include "chipdb.h"
 
 class QGraphicsItem;
@@ -14,7 +14,29 @@ class CircuitBuilder
 public:
     enum Direction { Up, Right, Down, Left };
 
-    CircuitBuilder(QGraphicsItem *parent);
+    // A part of a circuit, drawn as one item. It holds no items or fonts, so it can be built
+    // on any thread; its texts are only laid out by createItem(), on the GUI thread.
+    struct Part {
+        struct Text {
+            bool isLabel;
+            Direction anchor;
+            QPointF pos;
+            QString text;
+            qreal size;
+        };
+
+        QPainterPath path;
+        QPen pen;
+        qreal grid;
+        QString toolTip;
+        net_t net;
+        QVector<Text> texts;
+    };
+
+    // Parts are appended to `parts` as they are built.
+    CircuitBuilder(QVector<Part> *parts);
+
+    static QGraphicsPathItem *createItem(const Part &part, QGraphicsItem *parent);
 
     void setGrid(qreal grid);
     void setOrigin(qreal x, qreal y);
@@ -73,15 +95,15 @@ public:
 
     void addText(qreal x, qreal y, QString text, qreal size = 1);
 
-    QGraphicsPathItem *build(const QString &toolTip = "", net_t net = -1);
+    void build(const QString &toolTip = "", net_t net = -1);
 
 private:
     qreal _grid;
     QPointF _origin;
     QPen _pen;
-    QFont _font;
-    QGraphicsItem *_parent;
-    QPainterPath _path, _textPath;
+    QVector<Part> *_parts;
+    QPainterPath _path;
+    QVector<Part::Text> _texts;
 
     static void directionToVectors(Direction dir, QPointF *h, QPointF *v);
 };
@@ -0,0 +1,14 @@
+#include "diffloader.h"
+
+void DiffLoader::run()
+{
+    QSharedPointer<Bitstream> bitstream = loadBitstream();
+    if(_progress.isCancelled()) return;
+
+    QSharedPointer<BitstreamDiff> diff(new BitstreamDiff);
+    if(bitstream && diff->compare(*_chipDB, *_bitstream, *bitstream)) {
+        emit ready(diff);
+    } else {
+        emit failed();
+    }
+}
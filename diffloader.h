@@ -0,0 +1,21 @@
+#ifndef DIFFLOADER_H
+#define DIFFLOADER_H
+
+#include "bitstreamdiff.h"
+#include "bitstreamfileloader.h"
+
+// Loads a bitstream and compares `bitstream` with it, which must be for the same device.
+class DiffLoader : public BitstreamFileLoader
+{
+    Q_OBJECT
+public:
+    using BitstreamFileLoader::BitstreamFileLoader;
+
+private:
+    void run() override;
+
+signals:
+    void ready(QSharedPointer<const BitstreamDiff> diff);
+};
+
+#endif // DIFFLOADER_H
@@ -0,0 +1,53 @@
+#include "extractplan.h"
+
+ExtractPlan ExtractPlan::compile(const quint16 *bits, int count)
+{
+    ExtractPlan plan;
+    for(int index = 0; index < qMin(count, 32); index++) {
+        quint16 word = bits[index] >> 6;
+        quint8 shift = bits[index] & 63;
+
+        // The next bit of the value extends the last group if it comes after the bits of that
+        // group in the same word, and without BMI2, right after them.
+        if(!plan._groups.isEmpty() && plan._groups.last().word == word) {
+            Group &last = plan._groups.last();
+#if defined(__BMI2__)
+            bool extends = last.mask >> shift == 0;
+#else
+            bool extends = shift > 0 && last.mask >> (shift - 1) == 1;
+#endif
+            if(extends) {
+                last.mask |= 1ull << shift;
+                continue;
+            }
+        }
+
+        plan._groups.append(Group{1ull << shift, word, shift, quint8(index)});
+    }
+    return plan;
+}
+
+ExtractPlan ExtractPlan::fromFunction(const quint16 *bits, int count)
+{
+    QVector<quint16> reversed;
+    for(int index = count - 1; index >= 0; index--) {
+        reversed.append(bits[index]);
+    }
+    return compile(reversed.constData(), reversed.size());
+}
+
+ExtractPlan ExtractPlan::fromFunction(const QVector<quint16> &function)
+{
+    return fromFunction(function.constData(), function.size());
+}
+
+ExtractPlan ExtractPlan::fromFunction(const QVector<quint16> &function,
+                                      const QVector<int> &fieldBits)
+{
+    QVector<quint16> bits;
+    for(int bit : fieldBits) {
+        if(bit >= function.size()) return ExtractPlan();
+        bits.append(function[function.size() - 1 - bit]);
+    }
+    return compile(bits.constData(), bits.size());
+}
@@ -0,0 +1,65 @@
+#ifndef EXTRACTPLAN_H
+#define EXTRACTPLAN_H
+
+#include <QVector>
+#include "packedbits.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Gathers up to 32 bits of a tile into an integer. The bits are compiled into groups that are
+// each read from one 64-bit word with a mask and a shift, or with a single pext when built
+// with BMI2 (see CONFIG+=bmi2 in app.pro), rather than being read one by one.
+class ExtractPlan
+{
+public:
+    // Bit `i` of the extracted value is bit `bits[i]` of the tile.
+    static ExtractPlan compile(const quint16 *bits, int count);
+    // For a chipdb function or connection, whose bits are listed most significant first.
+    static ExtractPlan fromFunction(const quint16 *bits, int count);
+    static ExtractPlan fromFunction(const QVector<quint16> &function);
+    // Bit `i` of the extracted value is bit `fieldBits[i]` of the value of `function`. The plan
+    // is empty if the function is shorter than that.
+    static ExtractPlan fromFunction(const QVector<quint16> &function,
+                                    const QVector<int> &fieldBits);
+
+    // An empty plan always extracts 0.
+    bool isEmpty() const
+    {
+        return _groups.isEmpty();
+    }
+
+    uint extract(const PackedBits &bits) const
+    {
+        const quint64 *words = bits.words();
+        uint result          = 0;
+        for(const Group &group : _groups) {
+#if defined(__BMI2__)
+            result |= uint(_pext_u64(words[group.word], group.mask)) << group.dstShift;
+#else
+            result |= uint((words[group.word] & group.mask) >> group.srcShift) << group.dstShift;
+#endif
+        }
+        return result;
+    }
+
+    qint64 memorySize() const
+    {
+        return sizeof(ExtractPlan) + _groups.capacity() * sizeof(Group);
+    }
+
+private:
+    // The bits of `mask` in word `word` become bits `dstShift` and up of the value, in
+    // order. Without BMI2, the bits of `mask` are contiguous, starting at `srcShift`.
+    struct Group {
+        quint64 mask;
+        quint16 word;
+        quint8 srcShift;
+        quint8 dstShift;
+    };
+
+    QVector<Group> _groups;
+};
+
+#endif // EXTRACTPLAN_H
@@ -1,10 +1,21 @@
 #include <QGraphicsRectItem>
 #include <QGraphicsScene>
+#include <QPainter>
 #include "floorplanbuilder.h"
 #include "circuitbuilder.h"
 
 static const qreal GRID = 20;
 
+static const qreal TILE_WIDTH  = 75;
+static const qreal TILE_HEIGHT = 75;
+// The area of a tile, relative to its position.
+static const QRectF TILE_RECT(QPointF(-8, -8) * GRID,
+                              QSizeF(TILE_WIDTH - 16, TILE_HEIGHT - 16) * GRID);
+
+// The key of the data of tile items holding their coordinates; net items hold their net as
+// data 0.
+static const int TILE_DATA_KEY = 1;
+
 static const QColor BLOCK_COLOR = Qt::darkRed;
 static const QColor NET_COLOR   = Qt::darkGreen;
 
@@ -13,11 +24,107 @@ static const QColor TILE_IO_COLOR       = QColor::fromRgb(0xEAFBFB);
 static const QColor TILE_LOGIC_COLOR    = QColor::fromRgb(0xFBEAFB);
 static const QColor TILE_RAM_COLOR      = QColor::fromRgb(0xFBFBEA);
 
-FloorplanBuilder::FloorplanBuilder(ChipDB *chipDB, Bitstream *bitstream, QGraphicsScene *scene,
-                                   LUTNotation lutNotation, bool showUnusedLogic)
+namespace
+{
+// Draws the contents of a block RAM as hexadecimal words, 64 digits per line. The contents
+// are a copy, so that the item can outlive the bitstream, and are only decoded into words
+// once the item is first painted, i.e. once its tile is in view.
+class RAMContentsItem : public QGraphicsItem
+{
+public:
+    RAMContentsItem(const QVector<quint64> &data, int width, QGraphicsItem *parent)
+        : QGraphicsItem(parent), _data(data), _width(width)
+    {}
+
+    QRectF boundingRect() const override
+    {
+        return QRectF(QPointF(0, -1) * GRID, QSizeF(55, 41) * GRID);
+    }
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override
+    {
+        if(_lines.isEmpty()) decode();
+
+        painter->setPen(BLOCK_COLOR);
+        painter->setFont(QFont("monospace", 16));
+        for(int line = 0; line < _lines.size(); line++) {
+            painter->drawText(QPointF(0, line * 1.25) * GRID, _lines[line]);
+        }
+    }
+
+private:
+    QVector<quint64> _data;
+    int _width;
+    QStringList _lines;
+
+    void decode()
+    {
+        QVector<quint16> words =
+            Bitstream::decodeRAM(PackedBits(_data.constData(), Bitstream::RAM_BITS), _width);
+
+        int digits       = (_width + 3) / 4;
+        int wordsPerLine = 64 / digits;
+        QString line;
+        for(int address = 0; address < words.size(); address++) {
+            if(!line.isEmpty() && digits > 1) line += ' ';
+            line += QString::number(words[address], 16).rightJustified(digits, '0');
+            if((address + 1) % wordsPerLine == 0) {
+                _lines.append(line);
+                line.clear();
+            }
+        }
+    }
+};
+}
+
+FloorplanBuilder::FloorplanBuilder(const ChipDB *chipDB, const Bitstream *bitstream,
+                                   QGraphicsScene *scene, LUTNotation lutNotation,
+                                   bool showUnusedLogic)
     : _lutNotation(lutNotation), _showUnusedLogic(showUnusedLogic), _chip(chipDB),
       _bitstream(bitstream), _scene(scene)
-{}
+{
+    resolveLogicSlots();
+    compileLogicPlans();
+}
+
+void FloorplanBuilder::resolveLogicSlots()
+{
+    ChipDB::TileNetSlots logicNets;
+    if(_chip) logicNets = _chip->tileNetSlots.value("logic");
+
+    _logicNetNames = logicNets.names;
+    auto slot      = [&](const QString &name) { return logicNets.slotOf.value(name, -1); };
+
+    _logicSlots.globalClk  = slot("lutff_global/clk");
+    _logicSlots.globalCen  = slot("lutff_global/cen");
+    _logicSlots.globalSR   = slot("lutff_global/s_r");
+    _logicSlots.carryIn    = slot("carry_in");
+    _logicSlots.carryInMux = slot("carry_in_mux");
+    for(int lc = 0; lc < 8; lc++) {
+        QString lutff        = QString("lutff_%1").arg(lc);
+        LogicCellSlots &cell = _logicSlots.cells[lc];
+        for(int i = 0; i < 4; i++) {
+            cell.in[i] = slot(lutff + QString("/in_%1").arg(i));
+        }
+        cell.cout = slot(lutff + "/cout");
+        cell.lout = slot(lutff + "/lout");
+        cell.out  = slot(lutff + "/out");
+    }
+}
+
+void FloorplanBuilder::compileLogicPlans()
+{
+    ChipDB::TileBits logicBits;
+    if(_chip) logicBits = _chip->tilesBits.value("logic");
+
+    _logicPlans.negClk     = ExtractPlan::fromFunction(logicBits.functions.value("NegClk"));
+    _logicPlans.carryInSet = ExtractPlan::fromFunction(logicBits.functions.value("CarryInSet"));
+    for(int lc = 0; lc < 8; lc++) {
+        QVector<nbit_t> config = logicBits.functions.value(QString("LC_%1").arg(lc));
+        _logicPlans.config[lc] = ExtractPlan::fromFunction(config);
+        _logicPlans.lut[lc]    = ExtractPlan::fromFunction(config, Bitstream::LUT_BITS);
+    }
+}
 
 void FloorplanBuilder::buildTiles()
 {
@@ -28,28 +135,102 @@ void FloorplanBuilder::buildTiles()
     }
 }
 
-void FloorplanBuilder::buildTile(const Bitstream::Tile &tile)
+static QPointF tilePos(const ChipDB &chip, coord_t x, coord_t y)
 {
-    const qreal WIDTH  = 75;
-    const qreal HEIGHT = 75;
+    return QPointF(x * TILE_WIDTH, (chip.height - y) * TILE_HEIGHT) * GRID;
+}
 
-    QGraphicsRectItem *tileItem =
-        _scene->addRect(QRectF(QPointF(-8, -8) * GRID, QSizeF(WIDTH - 16, HEIGHT - 16) * GRID),
-                        Qt::NoPen, Qt::NoBrush);
-    tileItem->setPos(QPointF(tile.x * WIDTH, (_chip->height - tile.y) * HEIGHT) * GRID);
+QRectF FloorplanBuilder::tileRect(const ChipDB &chip, coord_t x, coord_t y)
+{
+    return TILE_RECT.translated(tilePos(chip, x, y));
+}
 
-    QGraphicsSimpleTextItem *coordsItem = _scene->addSimpleText(
-        QString("%3 (%1 %2)").arg(tile.x).arg(tile.y).arg(tile.type), QFont("sans", 18));
-    coordsItem->setParentItem(tileItem);
-    coordsItem->setPos(QPointF(-8, -10) * GRID);
+QPoint FloorplanBuilder::tileOf(const QGraphicsItem *tileItem)
+{
+    return tileItem->data(TILE_DATA_KEY).toPoint();
+}
+
+QVector<net_t> FloorplanBuilder::drawnNets(coord_t x, coord_t y) const
+{
+    QVector<net_t> nets;
+    const ChipDB::Tile *tile = _chip->findTile(x, y);
+    if(!tile || tile->type != "logic") return nets;
+
+    const LogicSlots &logic    = _logicSlots;
+    QVector<slot_t> drawnSlots = {logic.globalClk, logic.globalCen, logic.globalSR,
+                                  logic.carryIn, logic.carryInMux};
+    for(const LogicCellSlots &cell : logic.cells) {
+        drawnSlots << cell.in[0] << cell.in[1] << cell.in[2] << cell.in[3];
+        drawnSlots << cell.cout << cell.lout << cell.out;
+    }
+    for(slot_t slot : drawnSlots) {
+        net_t net = _chip->tileNet(x, y, slot);
+        if(net != -1) nets.append(net);
+    }
+    return nets;
+}
+
+QGraphicsRectItem *FloorplanBuilder::buildTile(const Bitstream::Tile &tile)
+{
+    QGraphicsRectItem *tileItem = createTileItem(drawTile(tile));
+    if(_scene) _scene->addItem(tileItem);
+    return tileItem;
+}
+
+FloorplanBuilder::TileDrawing FloorplanBuilder::drawTile(const Bitstream::Tile &tile)
+{
+    TileDrawing drawing;
+    drawing.x        = tile.x;
+    drawing.y        = tile.y;
+    drawing.pos      = tilePos(*_chip, tile.x, tile.y);
+    drawing.title    = QString("%3 (%1 %2)").arg(tile.x).arg(tile.y).arg(tile.type);
+    drawing.ramWidth = 0;
 
     if(tile.type == "logic") {
-        buildLogicTile(tile, tileItem);
+        drawLogicTile(tile, &drawing);
     } else if(tile.type == "io") {
-        buildIOTile(tile, tileItem);
+        drawIOTile(tile, &drawing);
     } else if(tile.type == "ramb" || tile.type == "ramt") {
-        buildRAMTile(tile, tileItem);
+        drawRAMTile(tile, &drawing);
     }
+    return drawing;
+}
+
+QGraphicsRectItem *FloorplanBuilder::createTileItem(const TileDrawing &drawing)
+{
+    QGraphicsRectItem *tileItem = new QGraphicsRectItem(TILE_RECT);
+    tileItem->setPen(Qt::NoPen);
+    tileItem->setBrush(drawing.color.isValid() ? QBrush(drawing.color) : QBrush(Qt::NoBrush));
+    tileItem->setPos(drawing.pos);
+    tileItem->setData(TILE_DATA_KEY, QPoint(drawing.x, drawing.y));
+
+    QGraphicsSimpleTextItem *coordsItem = new QGraphicsSimpleTextItem(drawing.title, tileItem);
+    coordsItem->setFont(QFont("sans", 18));
+    coordsItem->setPos(QPointF(-8, -10) * GRID);
+
+    for(const CircuitBuilder::Part &part : drawing.parts) {
+        CircuitBuilder::createItem(part, tileItem);
+    }
+
+    // The contents of the RAM are shown on its bottom tile, as read by the fabric.
+    if(!drawing.ramData.isEmpty()) {
+        QGraphicsSimpleTextItem *titleItem = new QGraphicsSimpleTextItem(
+            QString("INIT (%1×%2)").arg(Bitstream::RAM_BITS / drawing.ramWidth)
+                                   .arg(drawing.ramWidth),
+            tileItem);
+        titleItem->setFont(QFont("sans", 18));
+        titleItem->setPos(QPointF(-7, -7) * GRID);
+
+        RAMContentsItem *contentsItem =
+            new RAMContentsItem(drawing.ramData, drawing.ramWidth, tileItem);
+        contentsItem->setPos(QPointF(-7, -5) * GRID);
+    } else if(!drawing.ramNote.isEmpty()) {
+        QGraphicsSimpleTextItem *noteItem = new QGraphicsSimpleTextItem(drawing.ramNote, tileItem);
+        noteItem->setFont(QFont("sans", 18));
+        noteItem->setPos(QPointF(-7, -7) * GRID);
+    }
+
+    return tileItem;
 }
 
 QString FloorplanBuilder::recognizeFunction(uint fullLutData, bool hasA, bool hasB, bool hasC,
@@ -140,58 +321,60 @@ QString FloorplanBuilder::recognizeFunction(uint fullLutData, bool hasA, bool ha
     }
 }
 
-void FloorplanBuilder::buildLogicTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem)
+void FloorplanBuilder::drawLogicTile(const Bitstream::Tile &tile, TileDrawing *drawing)
 {
-    CircuitBuilder builder(tileItem);
+    CircuitBuilder builder(&drawing->parts);
     builder.setGrid(GRID);
 
-    const auto &tileNets   = _chip->tileNets(tile.x, tile.y);
-    const auto &tileBits   = _chip->tilesBits["logic"];
     const auto &netDrivers = _bitstream->netDrivers;
     const auto &netLoaded  = _bitstream->netLoaded;
 
+    // Nets the tile doesn't have are -1, have no driver and are not loaded.
+    auto netName   = [&](slot_t slot) { return _logicNetNames.value(slot); };
+    auto tileNet   = [&](slot_t slot) { return _chip->tileNet(tile.x, tile.y, slot); };
+    auto netDriver = [&](net_t net) { return net != -1 ? netDrivers[net] : -1; };
+    auto isLoaded  = [&](net_t net) { return net != -1 && netLoaded[net]; };
+
     // See topology and bitstream documentation at:
     //  * http://www.clifford.at/icestorm/logic_tile.html
     //  * http://www.clifford.at/icestorm/bitdocs-1k/tile_6_9.html
 
     // Variables used in this function:
-    //  * net name as a string, used to fetch net properties
-    //    QString <net_name> = "<net_name>";
+    //  * net name as a string, used to label the net
+    //    QString <net_name> = netName(<net_slot>);
     //  * chipdb net number corresponding to <net_name> (n_ stands for net)
-    //    net_t n_<net_name> = tileNets[<net_name>];
+    //    net_t n_<net_name> = tileNet(<net_slot>);
     //  * net that is driving <net_name> or -1 if it's not driven (d_ stands for driver)
-    //    net_t d_<net_name> = netDrivers[n_<net_name>];
+    //    net_t d_<net_name> = netDriver(n_<net_name>);
     //  * whether <net_name> is driving any other net (l_ stands for loaded)
-    //    bool  l_<net_name> = netLoaded[n_<net_name>];
+    //    bool  l_<net_name> = isLoaded(n_<net_name>);
     // NB: each tile has same net names but almost always different global nets
     // connected to them.
 
     // All FFs in the tile have the same clock polarity.
-    bool negClk = tile.extract(tileBits.functions["NegClk"]);
+    bool negClk = tile.extract(_logicPlans.negClk);
 
     // All FFs in the tile share the clock (clk), enable (cen) and set/reset (s_r)
     // nets. Whether the FF is enabled, whether the set/reset line sets or resets
     // the FF, and whether the set/reset is synchronous or asynchronous is determined
     // per individual FF.
-    QString lutff_global_clk = "lutff_global/clk";
-    net_t n_lutff_global_clk = tileNets[lutff_global_clk];
-    net_t d_lutff_global_clk = netDrivers[n_lutff_global_clk];
-    QString lutff_global_cen = "lutff_global/cen";
-    net_t n_lutff_global_cen = tileNets[lutff_global_cen];
-    net_t d_lutff_global_cen = netDrivers[n_lutff_global_cen];
-    QString lutff_global_s_r = "lutff_global/s_r";
-    net_t n_lutff_global_s_r = tileNets[lutff_global_s_r];
-    net_t d_lutff_global_s_r = netDrivers[n_lutff_global_s_r];
+    QString lutff_global_clk = netName(_logicSlots.globalClk);
+    net_t n_lutff_global_clk = tileNet(_logicSlots.globalClk);
+    net_t d_lutff_global_clk = netDriver(n_lutff_global_clk);
+    QString lutff_global_cen = netName(_logicSlots.globalCen);
+    net_t n_lutff_global_cen = tileNet(_logicSlots.globalCen);
+    net_t d_lutff_global_cen = netDriver(n_lutff_global_cen);
+    QString lutff_global_s_r = netName(_logicSlots.globalSR);
+    net_t n_lutff_global_s_r = tileNet(_logicSlots.globalSR);
+    net_t d_lutff_global_s_r = netDriver(n_lutff_global_s_r);
 
     // The net carry_in in tile (x, y) is connected to lutff_7/cout in tile (x, y-1).
     // The net carry_in_mux may be driven by carry_in or by a constant determined
     // by the bitstream bit CarryInSet.
-    QString carry_in     = "carry_in";
-    net_t n_carry_in     = tileNets[carry_in];
-    net_t d_carry_in     = netDrivers[n_carry_in];
-    QString carry_in_mux = "carry_in_mux";
-    net_t d_carry_in_mux = netDrivers[tileNets[carry_in_mux]];
-    bool carryInSet      = tile.extract(tileBits.functions["CarryInSet"]);
+    net_t n_carry_in     = tileNet(_logicSlots.carryIn);
+    net_t d_carry_in     = netDriver(n_carry_in);
+    net_t d_carry_in_mux = netDriver(tileNet(_logicSlots.carryInMux));
+    bool carryInSet      = tile.extract(_logicPlans.carryInSet);
 
     // hasCarryIn determines whether we have carry in from either the previous logic cell,
     // the tile to the bottom, or a constant driver.
@@ -240,15 +423,11 @@ void FloorplanBuilder::buildLogicTile(const Bitstream::Tile &tile, QGraphicsRect
         // include the LUT truth table, the FF and carry configuration in what
         // appears to be a modified Hilbert curve, so there's no straightforward
         // mapping to anything useful; it's also not documented anywhere.
-        uint lutffConfig = tile.extract(tileBits.functions[QString("LC_%1").arg(lc)]);
+        uint lutffConfig = tile.extract(_logicPlans.config[lc]);
 
         // Extract LUT truth table.
         // For any binary digits ABCD, LUT[ABCD]=(lutData>>0bABCD)&1.
-        uint lutData = 0;
-        for(nbit_t nbit : {4, 14, 15, 5, 6, 16, 17, 7, 3, 13, 12, 2, 1, 11, 10, 0}) {
-            lutData >>= 1;
-            if(lutffConfig & (1 << nbit)) lutData |= 1 << 15;
-        }
+        uint lutData = tile.extract(_logicPlans.lut[lc]);
 
         // Whether this logic cell's carry unit is enabled. If disabled, the carry
         // unit always outputs 0.
@@ -263,31 +442,32 @@ void FloorplanBuilder::buildLogicTile(const Bitstream::Tile &tile, QGraphicsRect
         // synchronous.
         bool asyncSR = lutffConfig & (1 << 19);
 
-        // Nets internal to this logic cell.
-        QString lutff      = QString("lutff_%1").arg(lc);
-        QString lutff_in0  = lutff + "/in_0";
-        net_t n_lutff_in0  = tileNets[lutff_in0];
-        net_t d_lutff_in0  = netDrivers[n_lutff_in0];
-        QString lutff_in1  = lutff + "/in_1";
-        net_t n_lutff_in1  = tileNets[lutff_in1];
-        net_t d_lutff_in1  = netDrivers[n_lutff_in1];
-        QString lutff_in2  = lutff + "/in_2";
-        net_t n_lutff_in2  = tileNets[lutff_in2];
-        net_t d_lutff_in2  = netDrivers[n_lutff_in2];
-        QString lutff_in3  = lutff + "/in_3";
-        net_t n_lutff_in3  = tileNets[lutff_in3];
-        net_t d_lutff_in3  = netDrivers[n_lutff_in3];
-        QString lutff_cin  = lc > 0 ? QString("lutff_%1/cout").arg(lc - 1) : "carry_in_mux";
-        net_t n_lutff_cin  = tileNets[lutff_cin];
-        QString lutff_cout = lutff + "/cout";
-        QString lutff_lin  = lc == 7 ? "" : QString("lutff_%1/lout").arg(lc - 1);
-        net_t n_lutff_lin  = lc == 7 ? -1 : tileNets[lutff_lin];
-        QString lutff_lout = lutff + "/lout";
-        net_t n_lutff_lout = tileNets[lutff_lout];
-        bool l_lutff_lout  = netLoaded[n_lutff_lout];
-        QString lutff_out  = lutff + "/out";
-        net_t n_lutff_out  = tileNets[lutff_out];
-        bool l_lutff_out   = netLoaded[n_lutff_out];
+        // Nets internal to this logic cell. The carry and LUT cascade inputs are the outputs
+        // of the previous logic cell.
+        const LogicCellSlots &cell = _logicSlots.cells[lc];
+        slot_t lutff_cin_slot = lc > 0 ? _logicSlots.cells[lc - 1].cout : _logicSlots.carryInMux;
+        QString lutff         = QString("lutff_%1").arg(lc);
+        QString lutff_in0     = netName(cell.in[0]);
+        net_t n_lutff_in0     = tileNet(cell.in[0]);
+        net_t d_lutff_in0     = netDriver(n_lutff_in0);
+        QString lutff_in1     = netName(cell.in[1]);
+        net_t n_lutff_in1     = tileNet(cell.in[1]);
+        net_t d_lutff_in1     = netDriver(n_lutff_in1);
+        QString lutff_in2     = netName(cell.in[2]);
+        net_t n_lutff_in2     = tileNet(cell.in[2]);
+        net_t d_lutff_in2     = netDriver(n_lutff_in2);
+        QString lutff_in3     = netName(cell.in[3]);
+        net_t n_lutff_in3     = tileNet(cell.in[3]);
+        net_t d_lutff_in3     = netDriver(n_lutff_in3);
+        QString lutff_cin     = netName(lutff_cin_slot);
+        net_t n_lutff_cin     = tileNet(lutff_cin_slot);
+        net_t n_lutff_lin     = lc > 0 && lc < 7 ? tileNet(_logicSlots.cells[lc - 1].lout) : -1;
+        QString lutff_lout    = netName(cell.lout);
+        net_t n_lutff_lout    = tileNet(cell.lout);
+        bool l_lutff_lout     = isLoaded(n_lutff_lout);
+        QString lutff_out     = netName(cell.out);
+        net_t n_lutff_out     = tileNet(cell.out);
+        bool l_lutff_out      = isLoaded(n_lutff_out);
 
         isActive |= hasDFF || l_lutff_lout || l_lutff_out;
 
@@ -533,19 +713,32 @@ void FloorplanBuilder::buildLogicTile(const Bitstream::Tile &tile, QGraphicsRect
     drawTileFFNet(15, -4, ffENs, lutff_global_cen, n_lutff_global_cen);
     drawTileFFNet(14, -3, ffSRs, lutff_global_s_r, n_lutff_global_s_r);
 
-    tileItem->setBrush(QBrush(isActive ? TILE_LOGIC_COLOR : TILE_INACTIVE_COLOR));
+    drawing->color = isActive ? TILE_LOGIC_COLOR : TILE_INACTIVE_COLOR;
 }
 
-void FloorplanBuilder::buildIOTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem)
+void FloorplanBuilder::drawIOTile(const Bitstream::Tile &tile, TileDrawing *drawing)
 {
     bool isActive = true;
 
-    tileItem->setBrush(QBrush(isActive ? TILE_IO_COLOR : TILE_INACTIVE_COLOR));
+    drawing->color = isActive ? TILE_IO_COLOR : TILE_INACTIVE_COLOR;
 }
 
-void FloorplanBuilder::buildRAMTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem)
+void FloorplanBuilder::drawRAMTile(const Bitstream::Tile &tile, TileDrawing *drawing)
 {
     bool isActive = true;
 
-    tileItem->setBrush(QBrush(isActive ? TILE_RAM_COLOR : TILE_INACTIVE_COLOR));
+    drawing->color = isActive ? TILE_RAM_COLOR : TILE_INACTIVE_COLOR;
+
+    // The contents of the RAM are shown on its bottom tile, as read by the fabric.
+    const PackedBits *data = _bitstream->ramData.find(tile.x, tile.y);
+    if(!data) {
+        if(tile.type == "ramb" && !_bitstream->hasRAMData) {
+            drawing->ramNote = "INIT not read from binary bitstreams";
+        }
+        return;
+    }
+
+    drawing->ramData.resize(PackedBits::wordCount(data->size()));
+    memcpy(drawing->ramData.data(), data->words(), drawing->ramData.size() * sizeof(quint64));
+    drawing->ramWidth = _bitstream->ramReadWidth(*_chip, tile.x, tile.y);
 }
@@ -1,9 +1,14 @@
 #ifndef FLOORPLANBUILDER_H
 #define FLOORPLANBUILDER_H
 
+#include <QColor>
+#include <QPoint>
+#include <QRectF>
 #include "bitstream.h"
 #include "chipdb.h"
+#include "circuitbuilder.h"
 
+class QGraphicsItem;
 class QGraphicsScene;
 class QGraphicsRectItem;
 
@@ -12,25 +17,89 @@ class FloorplanBuilder
 public:
     enum LUTNotation { VerboseLUTs, CompactLUTs, RawLUTs };
 
-    FloorplanBuilder(ChipDB *chipDB, Bitstream *bitstream, QGraphicsScene *scene,
+    // The drawing of a tile, as plain data; see drawTile().
+    struct TileDrawing {
+        coord_t x;
+        coord_t y;
+        QPointF pos;
+        QString title;
+        QColor color;
+        QVector<CircuitBuilder::Part> parts;
+        // The contents of the block RAM shown on the tile, if any, and their read width.
+        QVector<quint64> ramData;
+        int ramWidth;
+        // Shown on the tile instead when the contents are unknown.
+        QString ramNote;
+    };
+
+    // If `scene` is null, built tiles are not added to any scene. Such a builder only reads
+    // the chipdb and the bitstream, and its drawTile() can be used outside of the GUI thread.
+    FloorplanBuilder(const ChipDB *chipDB, const Bitstream *bitstream, QGraphicsScene *scene,
                      LUTNotation lutNotation = RawLUTs, bool showUnusedLogic = false);
 
+    // The area of the scene taken by the tile at (x, y).
+    static QRectF tileRect(const ChipDB &chip, coord_t x, coord_t y);
+    // The coordinates of the tile drawn by `tileItem`, as returned by buildTile().
+    static QPoint tileOf(const QGraphicsItem *tileItem);
+
+    // The nets whose drivers and loads the drawing of the tile at (x, y) depends on.
+    QVector<net_t> drawnNets(coord_t x, coord_t y) const;
+
     void buildTiles();
-    void buildTile(const Bitstream::Tile &tile);
-    void buildLogicTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem);
-    void buildIOTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem);
-    void buildRAMTile(const Bitstream::Tile &tile, QGraphicsRectItem *tileItem);
+    QGraphicsRectItem *buildTile(const Bitstream::Tile &tile);
+    // Draw a tile without creating any items, which createTileItem() then does; only the
+    // latter needs to run on the GUI thread.
+    TileDrawing drawTile(const Bitstream::Tile &tile);
+    static QGraphicsRectItem *createTileItem(const TileDrawing &drawing);
+    void drawLogicTile(const Bitstream::Tile &tile, TileDrawing *drawing);
+    void drawIOTile(const Bitstream::Tile &tile, TileDrawing *drawing);
+    void drawRAMTile(const Bitstream::Tile &tile, TileDrawing *drawing);
 
 private:
+    struct LogicCellSlots {
+        slot_t in[4];
+        slot_t cout;
+        slot_t lout;
+        slot_t out;
+    };
+
+    // The slots of the nets of logic tiles, resolved once for the chipdb.
+    struct LogicSlots {
+        slot_t globalClk;
+        slot_t globalCen;
+        slot_t globalSR;
+        slot_t carryIn;
+        slot_t carryInMux;
+        LogicCellSlots cells[8];
+    };
+
+    // The extraction plans of the bits of logic tiles, compiled once for the chipdb.
+    struct LogicPlans {
+        ExtractPlan negClk;
+        ExtractPlan carryInSet;
+        // The configuration of each logic cell, and its LUT truth table.
+        ExtractPlan config[8];
+        ExtractPlan lut[8];
+    };
+
     LUTNotation _lutNotation;
     bool _showUnusedLogic;
 
-    ChipDB *_chip;
-    Bitstream *_bitstream;
+    const ChipDB *_chip;
+    const Bitstream *_bitstream;
     QGraphicsScene *_scene;
 
+    QVector<QString> _logicNetNames;
+    LogicSlots _logicSlots;
+    LogicPlans _logicPlans;
+
+    void resolveLogicSlots();
+    void compileLogicPlans();
+
     QString recognizeFunction(uint lutData, bool hasA, bool hasB, bool hasC, bool hasD,
                               bool describeInputs = true) const;
 };
 
+Q_DECLARE_METATYPE(QVector<FloorplanBuilder::TileDrawing>)
+
 #endif // FLOORPLANBUILDER_H
@@ -6,13 +6,17 @@
 #include <QPinchGesture>
 #include <QTouchEvent>
 #include <QWheelEvent>
+#include <QtAlgorithms>
 #include "floorplanwidget.h"
 #include "bitstream.h"
 #include "chipdb.h"
 
+static const QColor TILE_HIGHLIGHT_COLOR = QColor::fromRgb(0xFF8000);
+
 FloorplanWidget::FloorplanWidget(QWidget *parent)
     : QGraphicsView(parent), _useOpenGL(false), _lutNotation(FloorplanBuilder::VerboseLUTs),
-      _showUnusedLogic(false), _bitstream(nullptr), _chipDB(nullptr), _hovered(nullptr)
+      _showUnusedLogic(false), _streaming(false),
+      _hovered(nullptr)
 {
     setUseOpenGL(_useOpenGL);
     setScene(&_scene);
@@ -51,11 +55,139 @@ void FloorplanWidget::setShowUnusedLogic(bool on)
     rebuildTiles();
 }
 
+FloorplanBuilder::LUTNotation FloorplanWidget::lutNotation() const
+{
+    return _lutNotation;
+}
+
+bool FloorplanWidget::showUnusedLogic() const
+{
+    return _showUnusedLogic;
+}
+
 void FloorplanWidget::rebuildTiles()
+{
+    if(_streaming) return;
+
+    clearScene();
+    FloorplanBuilder(_chipDB.data(), _bitstream.data(), &_scene, _lutNotation, _showUnusedLogic)
+        .buildTiles();
+    for(QGraphicsItem *item : _scene.items()) {
+        if(!item->parentItem()) addTileItem(item);
+    }
+    addTileHighlights();
+}
+
+void FloorplanWidget::clearScene()
 {
     _hovered = nullptr;
+    _highlighted.clear();
+    _tileItems.clear();
+    _netItems.clear();
+    _tileHighlights.clear();
     _scene.clear();
-    FloorplanBuilder(_chipDB, _bitstream, &_scene, _lutNotation, _showUnusedLogic).buildTiles();
+}
+
+void FloorplanWidget::addTileItem(QGraphicsItem *tileItem)
+{
+    QPoint tile = FloorplanBuilder::tileOf(tileItem);
+    _tileItems.insert(tile.x(), tile.y(), tileItem);
+    addNetItems(tileItem);
+}
+
+void FloorplanWidget::addNetItems(QGraphicsItem *item)
+{
+    QGraphicsPathItem *pathItem = qgraphicsitem_cast<QGraphicsPathItem *>(item);
+    if(pathItem && pathItem->data(0).isValid()) {
+        _netItems.insert(pathItem->data(0).toInt(), pathItem);
+    }
+    for(QGraphicsItem *child : item->childItems()) {
+        addNetItems(child);
+    }
+}
+
+void FloorplanWidget::removeNetItems(QGraphicsItem *item)
+{
+    QGraphicsPathItem *pathItem = qgraphicsitem_cast<QGraphicsPathItem *>(item);
+    if(pathItem && pathItem->data(0).isValid()) {
+        _netItems.remove(pathItem->data(0).toInt(), pathItem);
+    }
+    for(QGraphicsItem *child : item->childItems()) {
+        removeNetItems(child);
+    }
+}
+
+void FloorplanWidget::highlightNet(net_t net)
+{
+    highlightNets(net != (net_t)-1 ? QVector<net_t>{net} : QVector<net_t>());
+}
+
+void FloorplanWidget::highlightNets(const QVector<net_t> &nets)
+{
+    for(const auto &highlighted : _highlighted) {
+        highlighted.first->setPen(highlighted.second);
+    }
+    _highlighted.clear();
+
+    // Several of the nets may be in the same signal, whose items must only be saved once.
+    QVector<net_t> pathNets;
+    for(net_t net : nets) {
+        if(_bitstream && net < _bitstream->netGraph.netCount()) {
+            const NetGraph &graph = _bitstream->netGraph;
+            for(const net_t *pathNet = graph.pathBegin(net); pathNet != graph.pathEnd(net);
+                pathNet++) {
+                pathNets.append(*pathNet);
+            }
+        } else {
+            pathNets.append(net);
+        }
+    }
+    std::sort(pathNets.begin(), pathNets.end());
+    pathNets.erase(std::unique(pathNets.begin(), pathNets.end()), pathNets.end());
+
+    for(net_t pathNet : pathNets) {
+        for(QGraphicsPathItem *item : _netItems.values(pathNet)) {
+            _highlighted.append(qMakePair(item, item->pen()));
+            item->setPen(QPen(Qt::red));
+        }
+    }
+}
+
+void FloorplanWidget::highlightTiles(const QVector<QPoint> &tiles)
+{
+    qDeleteAll(_tileHighlights);
+    _tileHighlights.clear();
+    _highlightedTiles = tiles;
+    addTileHighlights();
+}
+
+void FloorplanWidget::addTileHighlights()
+{
+    if(!_chipDB) return;
+
+    for(const QPoint &tile : _highlightedTiles) {
+        QGraphicsRectItem *item =
+            _scene.addRect(FloorplanBuilder::tileRect(*_chipDB, tile.x(), tile.y()),
+                           QPen(TILE_HIGHLIGHT_COLOR, 40), Qt::NoBrush);
+        item->setZValue(1);
+        _tileHighlights.append(item);
+    }
+}
+
+void FloorplanWidget::showTile(coord_t x, coord_t y)
+{
+    showTiles({QPoint(x, y)});
+}
+
+void FloorplanWidget::showTiles(const QVector<QPoint> &tiles)
+{
+    if(!_chipDB || tiles.isEmpty()) return;
+
+    QRectF rect;
+    for(const QPoint &tile : tiles) {
+        rect |= FloorplanBuilder::tileRect(*_chipDB, tile.x(), tile.y());
+    }
+    fitInView(rect, Qt::KeepAspectRatio);
 }
 
 void FloorplanWidget::resetZoom()
@@ -64,15 +196,87 @@ void FloorplanWidget::resetZoom()
     fitInView(_scene.sceneRect(), Qt::KeepAspectRatio);
 }
 
-void FloorplanWidget::setData(Bitstream *bitstream, ChipDB *chipDB)
+void FloorplanWidget::setData(QSharedPointer<const Bitstream> bitstream,
+                              QSharedPointer<const ChipDB> chipDB)
 {
     _bitstream = bitstream;
     _chipDB    = chipDB;
+    _streaming = false;
 
     rebuildTiles();
     resetZoom();
 }
 
+void FloorplanWidget::beginData(QSharedPointer<const ChipDB> chipDB)
+{
+    _bitstream.clear();
+    _chipDB    = chipDB;
+    _highlightedTiles.clear();
+
+    _streaming               = true;
+    _streamedLUTNotation     = _lutNotation;
+    _streamedShowUnusedLogic = _showUnusedLogic;
+    _streamedRect            = QRectF();
+
+    clearScene();
+}
+
+void FloorplanWidget::addTiles(const QVector<FloorplanBuilder::TileDrawing> &drawings)
+{
+    bool first = _streamedRect.isNull();
+    for(const FloorplanBuilder::TileDrawing &drawing : drawings) {
+        QGraphicsItem *item = FloorplanBuilder::createTileItem(drawing);
+        _scene.addItem(item);
+        addTileItem(item);
+        _streamedRect |= item->mapRectToScene(item->boundingRect() | item->childrenBoundingRect());
+    }
+
+    _scene.setSceneRect(_streamedRect + QMarginsF(100, 100, 100, 100));
+    if(first) {
+        fitInView(_scene.sceneRect(), Qt::KeepAspectRatio);
+    }
+}
+
+void FloorplanWidget::endData(QSharedPointer<const Bitstream> bitstream)
+{
+    _bitstream = bitstream;
+    _streaming = false;
+
+    if(_lutNotation != _streamedLUTNotation || _showUnusedLogic != _streamedShowUnusedLogic) {
+        rebuildTiles();
+    }
+    resetZoom();
+}
+
+void FloorplanWidget::abortData()
+{
+    if(!_streaming) return;
+
+    setData(nullptr, nullptr);
+}
+
+void FloorplanWidget::updateData(QSharedPointer<const Bitstream> bitstream,
+                                const QVector<QPoint> &tiles)
+{
+    // Some of the highlighted items may be about to be deleted.
+    highlightNet(-1);
+    _hovered   = nullptr;
+    _bitstream = bitstream;
+
+    FloorplanBuilder builder(_chipDB.data(), _bitstream.data(), &_scene, _lutNotation,
+                             _showUnusedLogic);
+    for(const QPoint &tile : tiles) {
+        QGraphicsItem *oldItem = _tileItems.take(tile.x(), tile.y());
+        if(oldItem) {
+            removeNetItems(oldItem);
+            delete oldItem;
+        }
+
+        const Bitstream::Tile *bitstreamTile = _bitstream->findTile(tile.x(), tile.y());
+        if(bitstreamTile) addTileItem(builder.buildTile(*bitstreamTile));
+    }
+}
+
 void FloorplanWidget::wheelEvent(QWheelEvent *event)
 {
     if(event->modifiers() == Qt::ControlModifier) {
@@ -132,22 +336,15 @@ void FloorplanWidget::mouseMoveEvent(QMouseEvent *event)
     }
 
     if(netItem != _hovered) {
-        if(_hovered) {
-            _hovered->setPen(_hoveredOldPen);
-        }
-        if(netItem) {
-            _hoveredOldPen = netItem->pen();
-            netItem->setPen(QPen(Qt::red));
-            _hovered = netItem;
-        } else {
-            _hovered = nullptr;
-        }
+        _hovered = netItem;
+        highlightNet(_hovered ? _hovered->data(0).toInt() : -1);
 
         if(_hovered) {
             net_t net = netItem->data(0).toInt();
             QString symbol;
-            if(_bitstream->symbols.contains(net)) {
-                symbol = _bitstream->symbols[net];
+            int symbolIndex = _bitstream ? _bitstream->symbols.findNet(net) : -1;
+            if(symbolIndex != -1) {
+                symbol = _bitstream->symbols.name(symbolIndex);
             }
             emit netHovered(net, netItem->toolTip(), symbol);
         } else {
@@ -4,9 +4,11 @@
 #include <QGestureEvent>
 #include <QGraphicsPathItem>
 #include <QGraphicsView>
+#include <QMultiHash>
 #include "bitstream.h"
 #include "chipdb.h"
 #include "floorplanbuilder.h"
+#include "tilegrid.h"
 
 class FloorplanWidget : public QGraphicsView
 {
@@ -14,7 +16,23 @@ class FloorplanWidget : public QGraphicsView
 public:
     explicit FloorplanWidget(QWidget *parent = nullptr);
 
-    void setData(Bitstream *bitstream, ChipDB *chipDB);
+    void setData(QSharedPointer<const Bitstream> bitstream, QSharedPointer<const ChipDB> chipDB);
+
+    // Show tiles drawn elsewhere while the bitstream is still loading, between beginData()
+    // and endData() or abortData(). Tiles are drawn with the notation at the time of
+    // beginData(), and are rebuilt by endData() if it changed meanwhile.
+    void beginData(QSharedPointer<const ChipDB> chipDB);
+    void addTiles(const QVector<FloorplanBuilder::TileDrawing> &drawings);
+    void endData(QSharedPointer<const Bitstream> bitstream);
+    // Clear the tiles shown since beginData(), if the bitstream is still loading.
+    void abortData();
+
+    // Show `bitstream`, a reload of the shown bitstream for the same chipdb, rebuilding only
+    // the tiles at `tiles` and leaving the view where it is.
+    void updateData(QSharedPointer<const Bitstream> bitstream, const QVector<QPoint> &tiles);
+
+    FloorplanBuilder::LUTNotation lutNotation() const;
+    bool showUnusedLogic() const;
 
 public slots:
     void setUseOpenGL(bool on);
@@ -28,6 +46,17 @@ public slots:
     void rebuildTiles();
     void resetZoom();
 
+    // Highlight the nets of the signal of `net`, or none if it is -1. Before the bitstream
+    // has finished loading, only `net` itself is highlighted.
+    void highlightNet(net_t net);
+    // Highlight the nets of the signals of all of `nets`.
+    void highlightNets(const QVector<net_t> &nets);
+    // Mark the tiles at `tiles`, until the next bitstream is shown.
+    void highlightTiles(const QVector<QPoint> &tiles);
+    // Zoom onto the tile at (x, y), or onto all of `tiles`.
+    void showTile(coord_t x, coord_t y);
+    void showTiles(const QVector<QPoint> &tiles);
+
 signals:
     void netHovered(net_t net, QString name, QString symbol);
 
@@ -45,13 +74,30 @@ private:
     FloorplanBuilder::LUTNotation _lutNotation;
     bool _showUnusedLogic;
 
-    Bitstream *_bitstream;
-    ChipDB *_chipDB;
+    QSharedPointer<const Bitstream> _bitstream;
+    QSharedPointer<const ChipDB> _chipDB;
     QGraphicsScene _scene;
+
+    bool _streaming;
+    FloorplanBuilder::LUTNotation _streamedLUTNotation;
+    bool _streamedShowUnusedLogic;
+    QRectF _streamedRect;
     QGraphicsPathItem *_hovered;
-    QPen _hoveredOldPen;
+    // The item drawing each tile, the items drawing each net, and the highlighted ones with
+    // their original pens.
+    TileGrid<QGraphicsItem *> _tileItems;
+    QMultiHash<net_t, QGraphicsPathItem *> _netItems;
+    QVector<QPair<QGraphicsPathItem *, QPen>> _highlighted;
+    QVector<QPoint> _highlightedTiles;
+    QList<QGraphicsItem *> _tileHighlights;
 
     bool _suppressDrag;
+
+    void clearScene();
+    void addTileItem(QGraphicsItem *tileItem);
+    void addNetItems(QGraphicsItem *item);
+    void removeNetItems(QGraphicsItem *item);
+    void addTileHighlights();
 };
 
 #endif // FLOORPLANWIDGET_H
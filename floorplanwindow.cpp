@@ -1,11 +1,22 @@
+#include <QComboBox>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QLineEdit>
 #include <QMessageBox>
 #include <QProgressBar>
+#include <QTreeWidgetItem>
 #include "floorplanwindow.h"
+#include "loadprogress.h"
 #include "bitstreamloader.h"
-#include "chipdbloader.h"
+#include "diffloader.h"
+#include "reloadloader.h"
 #include "ui_floorplanwindow.h"
 
+static const int PROGRESS_INTERVAL = 50;
+static const int RELOAD_DELAY      = 200;
+// Only the first matches are listed, since listing tens of thousands would take too long.
+static const int SYMBOL_RESULT_LIMIT = 500;
+
 FloorplanWindow::FloorplanWindow(QWidget *parent)
     : QMainWindow(parent), _ui(new Ui::FloorplanWindow)
 {
@@ -13,6 +24,37 @@ FloorplanWindow::FloorplanWindow(QWidget *parent)
     _ui->statusBar->addPermanentWidget(&_progressBar);
     _progressBar.hide();
 
+    _progressTimer.setInterval(PROGRESS_INTERVAL);
+    connect(&_progressTimer, &QTimer::timeout, this, &FloorplanWindow::updateProgress);
+
+    _reloadTimer.setSingleShot(true);
+    _reloadTimer.setInterval(RELOAD_DELAY);
+    connect(&_reloadTimer, &QTimer::timeout, this, &FloorplanWindow::reloadBitstream);
+    connect(&_watcher, &QFileSystemWatcher::fileChanged, this, [=] { _reloadTimer.start(); });
+    connect(&_watcher, &QFileSystemWatcher::directoryChanged, this, [=] {
+        if(QFileInfo::exists(_filename)) _reloadTimer.start();
+    });
+
+    _ui->menuView->addSeparator();
+    _ui->menuView->addAction(_ui->clockDomainsDock->toggleViewAction());
+    _ui->menuView->addAction(_ui->differencesDock->toggleViewAction());
+    _ui->menuView->addAction(_ui->symbolsDock->toggleViewAction());
+    _ui->differencesDock->hide();
+
+    // The search modes are listed in the order of SymbolIndex::SearchMode.
+    connect(_ui->symbolSearch, &QLineEdit::textChanged, this, &FloorplanWindow::searchSymbols);
+    connect(_ui->symbolSearchMode,
+            static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            &FloorplanWindow::searchSymbols);
+    connect(_ui->symbols, &QTreeWidget::itemActivated, this, [=](QTreeWidgetItem *item) {
+        showSymbol(item->data(0, Qt::UserRole).toInt());
+    });
+
+    connect(_ui->differences, &QTreeWidget::itemActivated, this, [=](QTreeWidgetItem *item) {
+        QPoint tile = item->data(0, Qt::UserRole).toPoint();
+        _ui->floorplan->showTile(tile.x(), tile.y());
+    });
+
     connect(_ui->floorplan, &FloorplanWidget::netHovered, this,
             [=](net_t net, QString name, QString symbol) {
                 if(net != (net_t)-1) {
@@ -25,6 +67,24 @@ FloorplanWindow::FloorplanWindow(QWidget *parent)
                     _ui->statusBar->clearMessage();
                 }
             });
+
+    connect(&_chipDBs, &ChipDBRegistry::ready, this,
+            [=](QString device, QSharedPointer<const ChipDB> chipDB) {
+                if(device != _pendingDevice) return;
+
+                _pendingDevice.clear();
+                buildFloorplan(chipDB);
+            });
+    connect(&_chipDBs, &ChipDBRegistry::failed, this, [=](QString device) {
+        if(device != _pendingDevice) return;
+
+        _pendingDevice.clear();
+        _bitstreamLoader->abort();
+        hideProgress();
+        _ui->statusBar->clearMessage();
+        _ui->floorplan->setData(nullptr, nullptr);
+        QMessageBox::critical(this, "Error", "Cannot parse chipdb for " + device + "!");
+    });
 }
 
 FloorplanWindow::~FloorplanWindow()
@@ -39,32 +99,201 @@ void FloorplanWindow::openExample()
 
 void FloorplanWindow::openFile()
 {
-    QString fileName =
-        QFileDialog::getOpenFileName(this, "Open bitstream", "", "Bitstreams(*.txt *.asc)");
+    QString fileName = QFileDialog::getOpenFileName(this, "Open bitstream", "",
+                                                    "Bitstreams(*.txt *.asc *.bin *.gz)");
     if(!fileName.isNull()) {
         loadBitstream(fileName);
     }
 }
 
+void FloorplanWindow::compareFile()
+{
+    if(!_bitstream) return;
+
+    QString fileName = QFileDialog::getOpenFileName(this, "Compare with bitstream", "",
+                                                    "Bitstreams(*.txt *.asc *.bin *.gz)");
+    if(fileName.isNull()) return;
+
+    cancelDiff();
+    _ui->statusBar->showMessage("Comparing with bitstream " + fileName + "...");
+    showProgress();
+
+    DiffLoader *diffLoader = new DiffLoader(this, fileName, _chipDB, _bitstream);
+    connect(diffLoader, &QThread::finished, diffLoader, &QObject::deleteLater);
+    _diffLoader = diffLoader;
+
+    connect(diffLoader, &DiffLoader::ready, this, [=](QSharedPointer<const BitstreamDiff> diff) {
+        if(_diffLoader != diffLoader) return;
+
+        hideProgress();
+        showDifferences(*diff);
+        _ui->statusBar->showMessage(QString("%1 tiles differ.").arg(diff->tiles.size()));
+    });
+    connect(diffLoader, &DiffLoader::failed, this, [=] {
+        if(_diffLoader != diffLoader) return;
+
+        hideProgress();
+        _ui->statusBar->clearMessage();
+        QMessageBox::critical(this, "Error", "Cannot compare with bitstream " + fileName + "!");
+    });
+
+    diffLoader->start();
+}
+
+void FloorplanWindow::cancelDiff()
+{
+    if(_diffLoader) {
+        _diffLoader->abort();
+        _diffLoader = nullptr;
+    }
+}
+
+void FloorplanWindow::setAutoReload(bool on)
+{
+    if(!on) _reloadTimer.stop();
+    watchFile();
+}
+
+void FloorplanWindow::watchFile()
+{
+    if(!_watcher.files().isEmpty()) {
+        _watcher.removePaths(_watcher.files());
+    }
+    if(!_watcher.directories().isEmpty()) {
+        _watcher.removePaths(_watcher.directories());
+    }
+    // The built-in examples never change.
+    if(_ui->actionAutoReload->isChecked() && !_filename.isEmpty() && !_filename.startsWith(":")) {
+        // A file that is gone can only be watched for through its directory.
+        if(QFileInfo::exists(_filename)) {
+            _watcher.addPath(_filename);
+        } else {
+            _watcher.addPath(QFileInfo(_filename).absolutePath());
+        }
+    }
+}
+
+void FloorplanWindow::reloadBitstream()
+{
+    // Editors often replace the file instead of writing to it, which stops it being watched,
+    // and may leave no file for a while, in which case the directory is watched until it
+    // reappears.
+    watchFile();
+    if(!QFileInfo::exists(_filename)) return;
+
+    // Without a bitstream on display there is nothing to update, so load it from scratch.
+    if(!_bitstream) {
+        loadBitstream(_filename);
+        return;
+    }
+
+    cancelReload();
+    _ui->statusBar->showMessage("Reloading bitstream " + _filename + "...");
+
+    ReloadLoader *reloadLoader = new ReloadLoader(this, _filename, _chipDB, _bitstream);
+    connect(reloadLoader, &QThread::finished, reloadLoader, &QObject::deleteLater);
+    _reloadLoader = reloadLoader;
+
+    connect(reloadLoader, &ReloadLoader::ready, this,
+            [=](QSharedPointer<const Bitstream> bitstream, QVector<QPoint> changedTiles) {
+                if(_reloadLoader != reloadLoader) return;
+
+                // The differences were found against the previous version.
+                cancelDiff();
+                _ui->differences->clear();
+                _ui->floorplan->highlightTiles(QVector<QPoint>());
+
+                _bitstream = bitstream;
+                _ui->floorplan->updateData(bitstream, changedTiles);
+                showClockDomains(*bitstream);
+                searchSymbols();
+                _ui->statusBar->showMessage(
+                    QString("Reloaded, %1 tiles changed.").arg(changedTiles.size()));
+            });
+    connect(reloadLoader, &ReloadLoader::failed, this, [=] {
+        if(_reloadLoader != reloadLoader) return;
+
+        // Loading from scratch handles a change of device, and reports any error.
+        loadBitstream(_filename);
+    });
+
+    reloadLoader->start();
+}
+
+void FloorplanWindow::cancelReload()
+{
+    if(_reloadLoader) {
+        _reloadLoader->abort();
+        _reloadLoader = nullptr;
+    }
+}
+
 void FloorplanWindow::loadBitstream(QString filename)
 {
+    if(_bitstreamLoader) {
+        _bitstreamLoader->abort();
+        _ui->floorplan->abortData();
+    }
+    cancelChipDB();
+    cancelDiff();
+    cancelReload();
+
+    _filename = filename;
+    watchFile();
+
+    _bitstream.clear();
+    _chipDB.clear();
+    _ui->actionCompare->setEnabled(false);
+
     _ui->statusBar->showMessage("Loading bitstream " + filename + "...");
-    _progressBar.show();
+    _ui->clockDomains->clear();
+    _ui->differences->clear();
+    _ui->symbols->clear();
+    showProgress();
 
     BitstreamLoader *bitstreamLoader = new BitstreamLoader(this, filename);
     connect(bitstreamLoader, &QThread::finished, bitstreamLoader, &QObject::deleteLater);
+    _bitstreamLoader = bitstreamLoader;
+
+    connect(bitstreamLoader, &BitstreamLoader::deviceFound, this, [=](QString device) {
+        if(_bitstreamLoader != bitstreamLoader) return;
 
-    connect(bitstreamLoader, &BitstreamLoader::progress, this, [=](int cur, int max) {
-        _progressBar.setRange(0, max);
-        _progressBar.setValue(cur);
+        loadChipDB(device);
     });
-    connect(bitstreamLoader, &BitstreamLoader::ready, this, [=](Bitstream bitstream) {
-        _bitstream = bitstream;
-        loadChipDB(_bitstream.device);
+    connect(bitstreamLoader, &BitstreamLoader::tilesDrawn, this,
+            [=](QVector<FloorplanBuilder::TileDrawing> drawings) {
+                if(_bitstreamLoader != bitstreamLoader) return;
+
+                _ui->floorplan->addTiles(drawings);
+            });
+    connect(bitstreamLoader, &BitstreamLoader::ready, this,
+            [=](QSharedPointer<const Bitstream> bitstream) {
+                if(_bitstreamLoader != bitstreamLoader) return;
+
+                _bitstream = bitstream;
+                _ui->actionCompare->setEnabled(true);
+
+                hideProgress();
+                _ui->floorplan->endData(bitstream);
+                showClockDomains(*bitstream);
+                searchSymbols();
+                _ui->statusBar->showMessage("Ready.");
+            });
+    connect(bitstreamLoader, &BitstreamLoader::invalid, this, [=](QString comment) {
+        if(_bitstreamLoader != bitstreamLoader) return;
+
+        hideProgress();
+        _ui->statusBar->clearMessage();
+        _ui->floorplan->setData(nullptr, nullptr);
+        QMessageBox::critical(this, "Error",
+                              "Cannot validate bitstream produced by " + comment + "!");
     });
     connect(bitstreamLoader, &BitstreamLoader::failed, this, [=] {
-        _progressBar.hide();
+        if(_bitstreamLoader != bitstreamLoader) return;
+
+        hideProgress();
         _ui->statusBar->clearMessage();
+        _ui->floorplan->setData(nullptr, nullptr);
         QMessageBox::critical(this, "Error", "Cannot parse bitstream " + filename + "!");
     });
 
@@ -73,43 +302,170 @@ void FloorplanWindow::loadBitstream(QString filename)
 
 void FloorplanWindow::loadChipDB(QString device)
 {
-    if(_chipDBCache.contains(device)) {
-        updateFloorplan();
+    QSharedPointer<const ChipDB> chipDB = _chipDBs.find(device);
+    if(chipDB) {
+        buildFloorplan(chipDB);
         return;
     }
 
     _ui->statusBar->showMessage("Loading chipdb for " + device + "...");
-    _progressBar.show();
+    showProgress();
 
-    ChipDBLoader *chipDBLoader = new ChipDBLoader(this, device);
-    connect(chipDBLoader, &QThread::finished, chipDBLoader, &QObject::deleteLater);
+    _pendingDevice = device;
+    _chipDBs.request(device);
+}
 
-    connect(chipDBLoader, &ChipDBLoader::progress, this, [=](int cur, int max) {
-        _progressBar.setRange(0, max);
-        _progressBar.setValue(cur);
-    });
-    connect(chipDBLoader, &ChipDBLoader::ready, this, [=](ChipDB chipDB) {
-        _chipDBCache.insert(device, chipDB);
-        updateFloorplan();
-    });
-    connect(chipDBLoader, &ChipDBLoader::failed, this, [=] {
-        _progressBar.hide();
-        _ui->statusBar->clearMessage();
-        QMessageBox::critical(this, "Error", "Cannot parse chipdb for " + device + "!");
-    });
+void FloorplanWindow::cancelChipDB()
+{
+    if(_pendingDevice.isEmpty()) return;
+
+    _chipDBs.cancel(_pendingDevice);
+    _pendingDevice.clear();
+}
+
+void FloorplanWindow::buildFloorplan(QSharedPointer<const ChipDB> chipDB)
+{
+    _ui->statusBar->showMessage("Loading bitstream...");
+
+    _chipDB = chipDB;
+    _ui->floorplan->beginData(chipDB);
+    _bitstreamLoader->startBuilding(chipDB, _ui->floorplan->lutNotation(),
+                                    _ui->floorplan->showUnusedLogic());
+}
+
+void FloorplanWindow::showClockDomains(const Bitstream &bitstream)
+{
+    _ui->clockDomains->clear();
+    for(const Bitstream::ClockDomain &domain : bitstream.clockDomains) {
+        QString clock = "(none)";
+        if(domain.clock != (net_t)-1) {
+            int symbol = bitstream.symbols.findNet(domain.clock);
+            clock      = symbol != -1 ? bitstream.symbols.name(symbol)
+                                      : QString("Net %1").arg(domain.clock);
+        }
+        QString network = "Fabric", reach;
+        if(domain.network != -1) {
+            network = QString("glb_netwk_%1").arg(domain.network);
+        }
+        if(domain.network != -1 && _chipDB) {
+            // The tiles that the network reaches, whether or not they use it.
+            const ChipDB::GlobalNetwork &globalNetwork = _chipDB->globalNetworks[domain.network];
+            if(globalNetwork.net != (net_t)-1) {
+                reach = QString("%1 tiles, %2 column buffers")
+                            .arg(_chipDB->netSegmentsEnd(globalNetwork.net) -
+                                 _chipDB->netSegmentsBegin(globalNetwork.net))
+                            .arg(globalNetwork.columnBuffersEnd -
+                                 globalNetwork.columnBuffersBegin);
+            }
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(_ui->clockDomains);
+        item->setText(0, clock);
+        item->setText(1, network);
+        item->setText(2, domain.negEdge ? "Falling" : "Rising");
+        item->setData(3, Qt::DisplayRole, domain.ffCount);
+        item->setData(4, Qt::DisplayRole, domain.tileCount);
+        item->setData(5, Qt::DisplayRole, domain.columnBufferCount);
+        item->setText(6, reach);
+    }
+    _ui->clockDomains->sortByColumn(3, Qt::DescendingOrder);
+}
+
+void FloorplanWindow::showDifferences(const BitstreamDiff &diff)
+{
+    QVector<QPoint> tiles;
+    _ui->differences->clear();
+    for(const BitstreamDiff::Tile &tile : diff.tiles) {
+        tiles.append(QPoint(tile.x, tile.y));
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(_ui->differences);
+        item->setText(0, QString("%1 %2").arg(tile.x).arg(tile.y));
+        item->setData(0, Qt::UserRole, tiles.last());
+        item->setText(1, tile.type);
+        item->setData(2, Qt::DisplayRole, tile.bitCount);
+        item->setData(3, Qt::DisplayRole, tile.changeCount(BitstreamDiff::LUTChange));
+        item->setData(4, Qt::DisplayRole, tile.changeCount(BitstreamDiff::FFChange));
+        item->setData(5, Qt::DisplayRole, tile.changeCount(BitstreamDiff::CarryChange));
+        item->setData(6, Qt::DisplayRole, tile.changeCount(BitstreamDiff::BufferChange));
+        item->setData(7, Qt::DisplayRole, tile.changeCount(BitstreamDiff::RoutingChange));
+    }
+    _ui->differences->sortByColumn(2, Qt::DescendingOrder);
+    _ui->differencesDock->show();
+
+    _ui->floorplan->highlightTiles(tiles);
+}
+
+void FloorplanWindow::searchSymbols()
+{
+    _ui->symbols->clear();
+    if(!_bitstream) return;
+
+    const SymbolIndex &symbols = _bitstream->symbols;
+    SymbolIndex::SearchMode mode = SymbolIndex::SearchMode(_ui->symbolSearchMode->currentIndex());
+    int count;
+    QVector<int> found =
+        symbols.search(_ui->symbolSearch->text(), mode, SYMBOL_RESULT_LIMIT, &count);
+
+    for(int symbol : found) {
+        QStringList nets;
+        for(const net_t *net = symbols.netsBegin(symbol); net != symbols.netsEnd(symbol); net++) {
+            nets.append(QString::number(*net));
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(_ui->symbols);
+        item->setText(0, symbols.name(symbol));
+        item->setData(0, Qt::UserRole, symbol);
+        item->setText(1, nets.join(", "));
+    }
 
-    chipDBLoader->start();
+    if(count > found.size()) {
+        _ui->statusBar->showMessage(
+            QString("Showing %1 of %2 matching symbols.").arg(found.size()).arg(count));
+    }
 }
 
-void FloorplanWindow::updateFloorplan()
+void FloorplanWindow::showSymbol(int symbol)
 {
+    if(!_bitstream) return;
+
+    const SymbolIndex &symbols = _bitstream->symbols;
+    QVector<net_t> nets(symbols.netsBegin(symbol), symbols.netsEnd(symbol));
+    QVector<QPoint> tiles;
+    for(net_t net : nets) {
+        if(net < _bitstream->netGraph.netCount()) {
+            tiles += _bitstream->netGraph.pathTiles(*_chipDB, net);
+        }
+    }
+
+    _ui->floorplan->showTiles(tiles);
+    _ui->floorplan->highlightNets(nets);
+}
+
+void FloorplanWindow::showProgress()
+{
+    _progressBar.reset();
+    _progressBar.show();
+    _progressTimer.start();
+}
+
+void FloorplanWindow::hideProgress()
+{
+    _progressTimer.stop();
     _progressBar.hide();
-    if(_bitstream.process(_chipDBCache[_bitstream.device])) {
-        _ui->statusBar->showMessage("Ready.");
-        _ui->floorplan->setData(&_bitstream, &_chipDBCache[_bitstream.device]);
-    } else {
-        _ui->statusBar->clearMessage();
-        QMessageBox::critical(this, "Error",
-                              "Cannot validate bitstream produced by " + _bitstream.comment + "!");
+}
+
+void FloorplanWindow::updateProgress()
+{
+    // The bitstream waits for its chipdb, so show the progress of the chipdb while it loads.
+    const LoadProgress *progress = _chipDBs.progress(_pendingDevice);
+    if(!progress && _diffLoader) {
+        progress = &_diffLoader->progress();
+    }
+    if(!progress && _bitstreamLoader) {
+        progress = &_bitstreamLoader->progress();
     }
+    if(!progress) return;
+
+    _progressBar.setRange(0, progress->maximum());
+    _progressBar.setValue(progress->value());
 }
@@ -1,10 +1,19 @@
 #ifndef FLOORPLANWINDOW_H
 #define FLOORPLANWINDOW_H
 
+#include <QFileSystemWatcher>
 #include <QMainWindow>
+#include <QPointer>
 #include <QProgressBar>
+#include <QTimer>
 #include "bitstream.h"
 #include "chipdb.h"
+#include "chipdbregistry.h"
+
+class BitstreamDiff;
+class BitstreamLoader;
+class DiffLoader;
+class ReloadLoader;
 
 namespace Ui
 {
@@ -21,18 +30,46 @@ public:
 private:
     Ui::FloorplanWindow *_ui;
     QProgressBar _progressBar;
+    QTimer _progressTimer;
+
+    ChipDBRegistry _chipDBs;
+    QPointer<BitstreamLoader> _bitstreamLoader;
+    // The device whose chipdb the current bitstream waits for, if any.
+    QString _pendingDevice;
+    // The bitstream shown once it is loaded, and its chipdb.
+    QSharedPointer<const Bitstream> _bitstream;
+    QSharedPointer<const ChipDB> _chipDB;
+    QPointer<DiffLoader> _diffLoader;
 
-    QMap<QString, ChipDB> _chipDBCache;
-    Bitstream _bitstream;
+    // The file of the current bitstream, which is reloaded when it changes if auto-reload is
+    // on. Changes are only acted upon once the file has been quiet for a moment.
+    QString _filename;
+    QFileSystemWatcher _watcher;
+    QTimer _reloadTimer;
+    QPointer<ReloadLoader> _reloadLoader;
 
 private slots:
     void openExample();
     void openFile();
+    void compareFile();
     void loadBitstream(QString filename);
+    void setAutoReload(bool on);
+    void reloadBitstream();
+    void searchSymbols();
     void loadChipDB(QString device);
+    void updateProgress();
 
 private:
-    void updateFloorplan();
+    void buildFloorplan(QSharedPointer<const ChipDB> chipDB);
+    void showClockDomains(const Bitstream &bitstream);
+    void showDifferences(const BitstreamDiff &diff);
+    void showSymbol(int symbol);
+    void cancelDiff();
+    void cancelReload();
+    void watchFile();
+    void cancelChipDB();
+    void showProgress();
+    void hideProgress();
 };
 
 #endif // FLOORPLANWINDOW_H
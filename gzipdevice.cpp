@@ -0,0 +1,113 @@
+#include <QtDebug>
+#include <QFileDevice>
+#include <climits>
+#include "gzipdevice.h"
+
+static const qint64 CHUNK_SIZE = 1 << 16;
+
+GzipDevice::GzipDevice(QIODevice *source)
+    : _source(source), _stream(), _initialized(false), _finished(false)
+{}
+
+GzipDevice::~GzipDevice()
+{
+    if(_initialized) {
+        inflateEnd(&_stream);
+    }
+}
+
+bool GzipDevice::isCompressed(QIODevice *in)
+{
+    QByteArray magic = in->peek(2);
+    if(magic.size() < 2) return false;
+
+    uint first = uchar(magic[0]), second = uchar(magic[1]);
+    if(first == 0x1f && second == 0x8b) return true;
+
+    QFileDevice *file = qobject_cast<QFileDevice *>(in);
+    if(file && file->fileName().endsWith(".gz")) return true;
+
+    // A zlib header is deflate with a window of at most 32 KiB, no preset dictionary, and a
+    // check that makes it a multiple of 31. Plain text can pass the check alone, e.g. "x ".
+    bool deflate    = (first & 0x0f) == Z_DEFLATED && first >> 4 <= 7;
+    bool dictionary = second & 0x20;
+    return deflate && !dictionary && ((first << 8) | second) % 31 == 0;
+}
+
+bool GzipDevice::open(OpenMode mode)
+{
+    if((mode & ReadWrite) != ReadOnly) return false;
+
+    _stream = z_stream();
+    // Detect a gzip or a zlib header automatically.
+    if(inflateInit2(&_stream, MAX_WBITS + 32) != Z_OK) return false;
+
+    _initialized = true;
+    _finished    = false;
+    return QIODevice::open(mode);
+}
+
+void GzipDevice::close()
+{
+    if(_initialized) {
+        inflateEnd(&_stream);
+        _initialized = false;
+    }
+
+    QIODevice::close();
+}
+
+bool GzipDevice::isSequential() const
+{
+    return true;
+}
+
+bool GzipDevice::atEnd() const
+{
+    return _finished && QIODevice::atEnd();
+}
+
+bool GzipDevice::fillInput()
+{
+    _input = _source->read(CHUNK_SIZE);
+
+    _stream.next_in  = reinterpret_cast<Bytef *>(_input.data());
+    _stream.avail_in = _input.size();
+    return !_input.isEmpty();
+}
+
+qint64 GzipDevice::readData(char *data, qint64 maxSize)
+{
+    if(_finished) return -1;
+
+    uInt size         = qMin<qint64>(maxSize, UINT_MAX);
+    _stream.next_out  = reinterpret_cast<Bytef *>(data);
+    _stream.avail_out = size;
+    while(_stream.avail_out > 0) {
+        if(_stream.avail_in == 0 && !fillInput()) {
+            qCritical() << "cannot decompress: unexpected end of input";
+            return -1;
+        }
+
+        int result = inflate(&_stream, Z_NO_FLUSH);
+        if(result == Z_STREAM_END) {
+            // Concatenated members, as written by e.g. pigz, are decompressed as one stream.
+            if(_stream.avail_in == 0 && !fillInput()) {
+                _finished = true;
+                break;
+            }
+            inflateReset(&_stream);
+        } else if(result != Z_OK) {
+            qCritical() << "cannot decompress:" << (_stream.msg ? _stream.msg : "corrupted input");
+            return -1;
+        }
+    }
+
+    qint64 produced = size - _stream.avail_out;
+    return produced == 0 && _finished ? -1 : produced;
+}
+
+qint64 GzipDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
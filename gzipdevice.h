@@ -0,0 +1,41 @@
+#ifndef GZIPDEVICE_H
+#define GZIPDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <zlib.h>
+
+// A read-only device that decompresses gzip or zlib data from another device as it is read.
+//
+// The source device must be open, and is read from its current position in chunks, so that
+// its position tracks how much of the compressed input was consumed.
+class GzipDevice : public QIODevice
+{
+public:
+    explicit GzipDevice(QIODevice *source);
+    ~GzipDevice();
+
+    // Whether `in` starts with a gzip header, is a file named *.gz, or else starts with a zlib
+    // header. Does not consume input.
+    static bool isCompressed(QIODevice *in);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    bool atEnd() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QIODevice *_source;
+    QByteArray _input;
+    z_stream _stream;
+    bool _initialized;
+    bool _finished;
+
+    bool fillInput();
+};
+
+#endif // GZIPDEVICE_H
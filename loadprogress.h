@@ -0,0 +1,49 @@
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <QAtomicInt>
+
+// The progress of a load, updated by the loading thread and polled by the GUI, which avoids
+// queueing a signal for every step. Also carries the request to cancel the load.
+class LoadProgress
+{
+public:
+    LoadProgress() : _value(0), _maximum(0), _cancelled(0)
+    {}
+
+    // Record progress. Returns false once the load was cancelled, for use as the progress
+    // callback of the parsers.
+    bool update(int value, int maximum)
+    {
+        _value.store(value);
+        _maximum.store(maximum);
+        return !isCancelled();
+    }
+
+    int value() const
+    {
+        return _value.load();
+    }
+
+    int maximum() const
+    {
+        return _maximum.load();
+    }
+
+    void cancel()
+    {
+        _cancelled.store(1);
+    }
+
+    bool isCancelled() const
+    {
+        return _cancelled.load();
+    }
+
+private:
+    QAtomicInt _value;
+    QAtomicInt _maximum;
+    QAtomicInt _cancelled;
+};
+
+#endif // LOADPROGRESS_H
@@ -1,12 +1,17 @@
 #include <QApplication>
 #include "bitstream.h"
+#include "bitstreamdiff.h"
 #include "chipdb.h"
+#include "floorplanbuilder.h"
 #include "floorplanwindow.h"
 
 int main(int argc, char *argv[])
 {
-    qRegisterMetaType<ChipDB>();
-    qRegisterMetaType<Bitstream>();
+    qRegisterMetaType<QSharedPointer<const ChipDB>>();
+    qRegisterMetaType<QSharedPointer<const Bitstream>>();
+    qRegisterMetaType<QSharedPointer<const BitstreamDiff>>();
+    qRegisterMetaType<QVector<FloorplanBuilder::TileDrawing>>();
+    qRegisterMetaType<QVector<QPoint>>();
 
     QApplication a(argc, argv);
     FloorplanWindow w;
@@ -0,0 +1,83 @@
+#include <QtAlgorithms>
+#include "netgraph.h"
+
+NetGraph::NetGraph()
+{}
+
+// Lay out `count` ranges of values in compressed sparse row form. `keys` gives the range of
+// each value, or -1 for none; values are stored in increasing order within each range.
+static void buildRanges(const QVector<qint32> &keys, int count, QVector<quint32> *offsets,
+                        QVector<net_t> *values)
+{
+    offsets->fill(0, count + 1);
+    for(qint32 key : keys) {
+        if(key != -1) (*offsets)[key + 1]++;
+    }
+    for(int index = 0; index < count; index++) {
+        (*offsets)[index + 1] += (*offsets)[index];
+    }
+
+    values->resize(offsets->last());
+    QVector<quint32> next = *offsets;
+    for(net_t net = 0; net < keys.size(); net++) {
+        if(keys[net] != -1) (*values)[next[keys[net]]++] = net;
+    }
+}
+
+void NetGraph::build(const QVector<net_t> &netDrivers, const QVector<qint32> &netSignals,
+                     int signalCount)
+{
+    _drivers    = netDrivers;
+    _netSignals = netSignals;
+    buildRanges(netDrivers, netDrivers.size(), &_fanoutOffsets, &_fanout);
+    buildRanges(netSignals, signalCount, &_signalOffsets, &_signalNets);
+}
+
+int NetGraph::netCount() const
+{
+    return _drivers.size();
+}
+
+net_t NetGraph::driver(net_t net) const
+{
+    return _drivers[net];
+}
+
+const net_t *NetGraph::fanoutBegin(net_t net) const
+{
+    return _fanout.constData() + _fanoutOffsets[net];
+}
+
+const net_t *NetGraph::fanoutEnd(net_t net) const
+{
+    return _fanout.constData() + _fanoutOffsets[net + 1];
+}
+
+const net_t *NetGraph::pathBegin(net_t net) const
+{
+    return _signalNets.constData() + _signalOffsets[_netSignals[net]];
+}
+
+const net_t *NetGraph::pathEnd(net_t net) const
+{
+    return _signalNets.constData() + _signalOffsets[_netSignals[net] + 1];
+}
+
+QVector<QPoint> NetGraph::pathTiles(const ChipDB &chip, net_t net) const
+{
+    QVector<quint16> keys;
+    for(const net_t *pathNet = pathBegin(net); pathNet != pathEnd(net); pathNet++) {
+        for(const ChipDB::NetSegment *segment = chip.netSegmentsBegin(*pathNet);
+            segment != chip.netSegmentsEnd(*pathNet); segment++) {
+            keys.append(segment->tileX << 8 | segment->tileY);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    QVector<QPoint> tiles;
+    for(quint16 key : keys) {
+        tiles.append(QPoint(key >> 8, key & 0xff));
+    }
+    return tiles;
+}
@@ -0,0 +1,46 @@
+#ifndef NETGRAPH_H
+#define NETGRAPH_H
+
+#include <QPoint>
+#include <QVector>
+#include "chipdb.h"
+
+// Answers queries about how the nets of a processed bitstream are connected, from flat
+// adjacency arrays built once: the driver and the fanout of every net through buffers, and
+// the nets of its signal, which are connected to it through buffers and routing switches.
+//
+// The graph never changes once built, so any number of threads may query it at once.
+class NetGraph
+{
+public:
+    NetGraph();
+
+    // `netSignals` numbers the signal of every net from 0 up to `signalCount`.
+    void build(const QVector<net_t> &netDrivers, const QVector<qint32> &netSignals,
+               int signalCount);
+
+    int netCount() const;
+    // Returns -1 if no buffer drives `net`.
+    net_t driver(net_t net) const;
+    // The nets driven by `net`, lowest first.
+    const net_t *fanoutBegin(net_t net) const;
+    const net_t *fanoutEnd(net_t net) const;
+    // The nets of the signal of `net`, lowest first, including `net` itself.
+    const net_t *pathBegin(net_t net) const;
+    const net_t *pathEnd(net_t net) const;
+    // The tiles that the nets of the signal of `net` have segments in, by column then row.
+    QVector<QPoint> pathTiles(const ChipDB &chip, net_t net) const;
+
+private:
+    QVector<net_t> _drivers;
+    // The fanout of net `net` is _fanout[_fanoutOffsets[net]] up to
+    // _fanout[_fanoutOffsets[net + 1]], and the nets of signal `signal` are likewise ranges
+    // of `_signalNets`.
+    QVector<quint32> _fanoutOffsets;
+    QVector<net_t> _fanout;
+    QVector<qint32> _netSignals;
+    QVector<quint32> _signalOffsets;
+    QVector<net_t> _signalNets;
+};
+
+#endif // NETGRAPH_H
@@ -0,0 +1,107 @@
+#ifndef PACKEDBITS_H
+#define PACKEDBITS_H
+
+#include <cstring>
+#include <QList>
+#include <QVector>
+
+// A read-only view of bits packed into 64-bit words: bit `i` is bit `i % 64` of word `i / 64`.
+// The words are usually owned by a BitArena, and are only valid as long as it is.
+class PackedBits
+{
+public:
+    PackedBits() : _words(nullptr), _size(0)
+    {}
+
+    PackedBits(const quint64 *words, int size) : _words(words), _size(size)
+    {}
+
+    static int wordCount(int size)
+    {
+        return (size + 63) / 64;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    bool isEmpty() const
+    {
+        return _size == 0;
+    }
+
+    const quint64 *words() const
+    {
+        return _words;
+    }
+
+    bool testBit(int i) const
+    {
+        return (_words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    bool operator[](int i) const
+    {
+        return testBit(i);
+    }
+
+    // Whether no bit is set, checked a word at a time.
+    bool isClear() const
+    {
+        for(int index = 0; index < wordCount(_size); index++) {
+            if(_words[index]) return false;
+        }
+        return true;
+    }
+
+    // Compares the bits a word at a time; the bits past the end of the last word are zero.
+    bool operator==(const PackedBits &other) const
+    {
+        return _size == other._size &&
+               (_size == 0 ||
+                std::memcmp(_words, other._words, wordCount(_size) * sizeof(quint64)) == 0);
+    }
+
+    bool operator!=(const PackedBits &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    const quint64 *_words;
+    int _size;
+};
+
+// Allocates zeroed 64-bit words out of large blocks that are never moved or freed before the
+// arena, so that the bits of many tiles can share a few allocations.
+class BitArena
+{
+public:
+    BitArena() : _current(nullptr), _used(BLOCK_WORDS)
+    {}
+
+    quint64 *allocate(int count)
+    {
+        if(count > BLOCK_WORDS - _used) {
+            // The block is never shared, so its words are never detached and moved.
+            _blocks.append(QVector<quint64>(qMax(count, int(BLOCK_WORDS)), 0));
+            _current = _blocks.last().data();
+            _used    = 0;
+        }
+
+        _used += count;
+        return _current + _used - count;
+    }
+
+private:
+    static const int BLOCK_WORDS = 8192;
+
+    QList<QVector<quint64>> _blocks;
+    quint64 *_current;
+    int _used;
+
+    Q_DISABLE_COPY(BitArena)
+};
+
+#endif // PACKEDBITS_H
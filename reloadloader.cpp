@@ -0,0 +1,13 @@
+#include "reloadloader.h"
+
+void ReloadLoader::run()
+{
+    QSharedPointer<Bitstream> bitstream = loadBitstream();
+    if(_progress.isCancelled()) return;
+
+    if(bitstream && bitstream->process(*_chipDB, ChipDB::ParallelParse)) {
+        emit ready(bitstream, bitstream->changedTiles(*_chipDB, *_bitstream));
+    } else {
+        emit failed();
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef RELOADLOADER_H
+#define RELOADLOADER_H
+
+#include <QPoint>
+#include <QVector>
+#include "bitstreamfileloader.h"
+
+// Loads a new version of `bitstream` from `filename`, and finds the tiles whose floorplan
+// changed. Fails if the new version is for another device, so that it is loaded from scratch.
+class ReloadLoader : public BitstreamFileLoader
+{
+    Q_OBJECT
+public:
+    using BitstreamFileLoader::BitstreamFileLoader;
+
+private:
+    void run() override;
+
+signals:
+    void ready(QSharedPointer<const Bitstream> bitstream, QVector<QPoint> changedTiles);
+};
+
+#endif // RELOADLOADER_H
@@ -0,0 +1,170 @@
+#include <QByteArrayMatcher>
+#include <QHash>
+#include <QPair>
+#include <QtAlgorithms>
+#include "symbolindex.h"
+
+SymbolIndex::SymbolIndex()
+{}
+
+void SymbolIndex::add(net_t net, const char *name, int size)
+{
+    _nameOffsets.append(_names.size());
+    _names.append(name, size);
+    _names.append('\0');
+    _nets.append(net);
+}
+
+void SymbolIndex::build()
+{
+    QVector<int> order(_nets.size());
+    for(int index = 0; index < order.size(); index++) {
+        order[index] = index;
+    }
+    auto nameAt = [&](int index) { return _names.constData() + _nameOffsets[index]; };
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        int compare = qstrcmp(nameAt(a), nameAt(b));
+        return compare != 0 ? compare < 0 : _nets[a] < _nets[b];
+    });
+
+    // Lay the names out again in sorted order, once each, with the nets they name. Each net
+    // keeps the symbol of the last name added for it.
+    QByteArray names;
+    QVector<quint32> nameOffsets, netOffsets;
+    QVector<net_t> nets;
+    QHash<net_t, QPair<int, qint32>> lastSymbols;
+    names.reserve(_names.size());
+    nets.reserve(_nets.size());
+    const char *previous = nullptr;
+    for(int index : order) {
+        const char *name = nameAt(index);
+        if(!previous || qstrcmp(previous, name) != 0) {
+            nameOffsets.append(names.size());
+            netOffsets.append(nets.size());
+            names.append(name);
+            names.append('\0');
+            previous = name;
+        }
+        if(nets.size() == int(netOffsets.last()) || nets.last() != _nets[index]) {
+            nets.append(_nets[index]);
+        }
+
+        auto last = lastSymbols.find(_nets[index]);
+        if(last == lastSymbols.end() || last->first < index) {
+            lastSymbols.insert(_nets[index], qMakePair(index, qint32(nameOffsets.size() - 1)));
+        }
+    }
+    nameOffsets.append(names.size());
+    netOffsets.append(nets.size());
+
+    _names       = names;
+    _nameOffsets = nameOffsets;
+    _netOffsets  = netOffsets;
+    _nets        = nets;
+
+    _netSymbols.clear();
+    _netSymbols.reserve(lastSymbols.size());
+    for(auto last = lastSymbols.constBegin(); last != lastSymbols.constEnd(); ++last) {
+        _netSymbols.append(NetSymbol{last.key(), last->second});
+    }
+    std::sort(_netSymbols.begin(), _netSymbols.end(),
+              [](const NetSymbol &a, const NetSymbol &b) { return a.net < b.net; });
+}
+
+void SymbolIndex::clear()
+{
+    *this = SymbolIndex();
+}
+
+int SymbolIndex::size() const
+{
+    return _netOffsets.isEmpty() ? 0 : _netOffsets.size() - 1;
+}
+
+bool SymbolIndex::isEmpty() const
+{
+    return size() == 0;
+}
+
+QString SymbolIndex::name(int symbol) const
+{
+    return QString::fromUtf8(_names.constData() + _nameOffsets[symbol],
+                             _nameOffsets[symbol + 1] - _nameOffsets[symbol] - 1);
+}
+
+const net_t *SymbolIndex::netsBegin(int symbol) const
+{
+    return _nets.constData() + _netOffsets[symbol];
+}
+
+const net_t *SymbolIndex::netsEnd(int symbol) const
+{
+    return _nets.constData() + _netOffsets[symbol + 1];
+}
+
+int SymbolIndex::findNet(net_t net) const
+{
+    auto it = std::lower_bound(_netSymbols.begin(), _netSymbols.end(), net,
+                               [](const NetSymbol &entry, net_t net) { return entry.net < net; });
+    return it != _netSymbols.end() && it->net == net ? it->symbol : -1;
+}
+
+int SymbolIndex::symbolAt(int offset) const
+{
+    return std::upper_bound(_nameOffsets.begin(), _nameOffsets.end(), quint32(offset)) -
+           _nameOffsets.begin() - 1;
+}
+
+QVector<int> SymbolIndex::search(const QString &query, SearchMode mode, int limit,
+                                 int *count) const
+{
+    QVector<int> symbols;
+    int matches = 0;
+    if(isEmpty()) {
+        if(count) *count = 0;
+        return symbols;
+    }
+
+    // UTF-8 encodes no character as part of another, so the names can be matched bytewise.
+    QByteArray pattern = query.toUtf8();
+    auto match         = [&](int symbol) {
+        if(limit == -1 || symbols.size() < limit) symbols.append(symbol);
+        matches++;
+    };
+
+    if(mode == PrefixSearch) {
+        // The names starting with the query are the ones sorted from the query on.
+        int symbol = std::lower_bound(_nameOffsets.begin(), _nameOffsets.end() - 1, pattern,
+                                      [&](quint32 offset, const QByteArray &key) {
+                                          return qstrcmp(_names.constData() + offset,
+                                                         key.constData()) < 0;
+                                      }) -
+                     _nameOffsets.begin();
+        for(; symbol < size(); symbol++) {
+            const char *name = _names.constData() + _nameOffsets[symbol];
+            if(qstrncmp(name, pattern.constData(), pattern.size()) != 0) break;
+            match(symbol);
+        }
+    } else {
+        // The names are separated by zeros, which the query can't contain, so no match spans
+        // two names. Once a name matches, the rest of it is skipped.
+        QByteArrayMatcher matcher(pattern);
+        int from = 0;
+        while(from < _names.size()) {
+            int offset = matcher.indexIn(_names, from);
+            if(offset == -1) break;
+
+            int symbol = symbolAt(offset);
+            if(mode == SubstringSearch || offset == int(_nameOffsets[symbol]) ||
+               _names[offset - 1] == '.') {
+                match(symbol);
+                from = _nameOffsets[symbol + 1];
+            } else {
+                from = offset + 1;
+            }
+        }
+    }
+
+    if(count) *count = matches;
+    return symbols;
+}
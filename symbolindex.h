@@ -0,0 +1,70 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "chipdb.h"
+
+// The symbols of a bitstream, which name its nets. The names are stored one after another
+// in a single arena as UTF-8, in sorted order, so that they can be searched by prefix with a binary
+// search and by substring with a single scan of the arena. Each distinct name is one symbol,
+// numbered in name order, and may name several nets.
+//
+// The index never changes once built, so any number of threads may query it at once.
+class SymbolIndex
+{
+public:
+    enum SearchMode {
+        // Names starting with the query.
+        PrefixSearch,
+        // Names containing the query anywhere.
+        SubstringSearch,
+        // Names containing the query from the start of one of their `.`-separated components,
+        // e.g. `alu.sum` finds `cpu.alu.sum[3]`.
+        HierarchicalSearch
+    };
+
+    SymbolIndex();
+
+    // Add a symbol naming `net`, from the `size` bytes of UTF-8 at `name`. The symbols can
+    // only be queried once build() is called.
+    void add(net_t net, const char *name, int size);
+    void build();
+    void clear();
+
+    int size() const;
+    bool isEmpty() const;
+    QString name(int symbol) const;
+    // The nets named by `symbol`, lowest first.
+    const net_t *netsBegin(int symbol) const;
+    const net_t *netsEnd(int symbol) const;
+    // Returns the symbol naming `net` that was added last, or -1 if none does. A later
+    // .sym entry for a net takes precedence over earlier ones, as in icebox.
+    int findNet(net_t net) const;
+
+    // The symbols matching `query`, in name order. At most `limit` of them are returned,
+    // unless it is -1; `count`, if given, is set to the number of symbols matching.
+    QVector<int> search(const QString &query, SearchMode mode, int limit = -1,
+                        int *count = nullptr) const;
+
+private:
+    struct NetSymbol {
+        net_t net;
+        qint32 symbol;
+    };
+
+    // The name of symbol `symbol` is _names[_nameOffsets[symbol]] up to the terminating zero
+    // before _names[_nameOffsets[symbol + 1]], and its nets are likewise a range of `_nets`.
+    // Until build(), the names are in the order they were added, one per net in `_nets`.
+    QByteArray _names;
+    QVector<quint32> _nameOffsets;
+    QVector<quint32> _netOffsets;
+    QVector<net_t> _nets;
+    // The symbol that findNet() returns for each net that has one, sorted by net.
+    QVector<NetSymbol> _netSymbols;
+
+    int symbolAt(int offset) const;
+};
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,239 @@
+#ifndef TILEGRID_H
+#define TILEGRID_H
+
+#include <QVector>
+
+// A dense grid of values indexed by tile coordinates, which may have holes (e.g. the corners
+// of a chip). The values are stored contiguously, column by column, so iteration visits them
+// in the same order as a QMap keyed by (x, y) would. Adding tiles outside of the grid grows
+// its storage geometrically, so that growing it tile by tile takes amortized constant time.
+//
+// The const methods never modify the grid, so any number of threads may read it at once.
+template <class T>
+class TileGrid
+{
+    template <class Grid, class Value>
+    class Iterator
+    {
+    public:
+        Iterator(Grid *grid, int index) : _grid(grid), _index(index)
+        {
+            skipHoles();
+        }
+
+        int x() const
+        {
+            return _index / _grid->_capacityHeight;
+        }
+
+        int y() const
+        {
+            return _index % _grid->_capacityHeight;
+        }
+
+        Value &operator*() const
+        {
+            return _grid->_values[_index];
+        }
+
+        Value *operator->() const
+        {
+            return &_grid->_values[_index];
+        }
+
+        Iterator &operator++()
+        {
+            _index++;
+            skipHoles();
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return _index != other._index;
+        }
+
+    private:
+        Grid *_grid;
+        int _index;
+
+        void skipHoles()
+        {
+            while(_index < _grid->_present.size() && !_grid->_present[_index]) {
+                _index++;
+            }
+        }
+    };
+
+public:
+    typedef Iterator<TileGrid, T> iterator;
+    typedef Iterator<const TileGrid, const T> const_iterator;
+
+    TileGrid() : _width(0), _height(0), _capacityWidth(0), _capacityHeight(0), _count(0)
+    {}
+
+    int width() const
+    {
+        return _width;
+    }
+
+    int height() const
+    {
+        return _height;
+    }
+
+    // The number of tiles that are present.
+    int size() const
+    {
+        return _count;
+    }
+
+    bool isEmpty() const
+    {
+        return _count == 0;
+    }
+
+    // The memory allocated for the storage of the grid, in bytes.
+    qint64 memorySize() const
+    {
+        return qint64(_values.capacity()) * sizeof(T) + qint64(_present.capacity()) * sizeof(bool);
+    }
+
+    void clear()
+    {
+        *this = TileGrid();
+    }
+
+    // Change the size of the grid, dropping the tiles that fall outside of it.
+    void resize(int width, int height)
+    {
+        if(width == _width && height == _height) return;
+
+        reallocate(width, height);
+        _width  = width;
+        _height = height;
+    }
+
+    bool contains(int x, int y) const
+    {
+        return x < _width && y < _height && _present[index(x, y)];
+    }
+
+    // Returns null if there is no tile at (x, y).
+    const T *find(int x, int y) const
+    {
+        return contains(x, y) ? &_values[index(x, y)] : nullptr;
+    }
+
+    T *find(int x, int y)
+    {
+        return contains(x, y) ? &_values[index(x, y)] : nullptr;
+    }
+
+    T value(int x, int y, const T &defaultValue = T()) const
+    {
+        return contains(x, y) ? _values[index(x, y)] : defaultValue;
+    }
+
+    // Returns the tile at (x, y), adding a default-constructed one if there is none.
+    // The grid is grown if (x, y) is outside of it.
+    T &operator()(int x, int y)
+    {
+        if(x >= _capacityWidth || y >= _capacityHeight) {
+            reallocate(x >= _capacityWidth ? qMax(x + 1, 2 * _capacityWidth) : _capacityWidth,
+                       y >= _capacityHeight ? qMax(y + 1, 2 * _capacityHeight) : _capacityHeight);
+        }
+        _width  = qMax(x + 1, _width);
+        _height = qMax(y + 1, _height);
+
+        int i = index(x, y);
+        if(!_present[i]) {
+            _present[i] = true;
+            _count++;
+        }
+        return _values[i];
+    }
+
+    T &insert(int x, int y, const T &value)
+    {
+        return (*this)(x, y) = value;
+    }
+
+    // Removes the tile at (x, y) and returns it, or a default-constructed one if there is none.
+    T take(int x, int y)
+    {
+        if(!contains(x, y)) return T();
+
+        int i       = index(x, y);
+        T value     = _values[i];
+        _values[i]  = T();
+        _present[i] = false;
+        _count--;
+        return value;
+    }
+
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, _present.size());
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, _present.size());
+    }
+
+private:
+    int _width;
+    int _height;
+    // The size of the storage, which may be larger than the grid.
+    int _capacityWidth;
+    int _capacityHeight;
+    int _count;
+    QVector<T> _values;
+    QVector<bool> _present;
+
+    int index(int x, int y) const
+    {
+        return x * _capacityHeight + y;
+    }
+
+    // Move the tiles into storage of the given size, dropping the tiles that fall outside
+    // of it.
+    void reallocate(int capacityWidth, int capacityHeight)
+    {
+        QVector<T> values(capacityWidth * capacityHeight);
+        QVector<bool> present(capacityWidth * capacityHeight, false);
+        int count = 0;
+        for(auto it = begin(); it != end(); ++it) {
+            if(it.x() < capacityWidth && it.y() < capacityHeight) {
+                int i      = it.x() * capacityHeight + it.y();
+                values[i]  = std::move(*it);
+                present[i] = true;
+                count++;
+            }
+        }
+
+        _capacityWidth  = capacityWidth;
+        _capacityHeight = capacityHeight;
+        _count          = count;
+        _values         = values;
+        _present        = present;
+    }
+};
+
+#endif // TILEGRID_H
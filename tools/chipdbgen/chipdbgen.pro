@@ -0,0 +1,30 @@
+CONFIG  += c++11 console
+CONFIG  -= app_bundle
+QT       = core concurrent
+LIBS    += -lz
+
+TARGET   = chipdbgen
+TEMPLATE = app
+# Where app.pro expects it, also for debug_and_release builds.
+DESTDIR  = $$OUT_PWD
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += \
+    main.cpp \
+    $$ROOT/chipdb.cpp \
+    $$ROOT/chipdbimage.cpp \
+    $$ROOT/extractplan.cpp \
+    $$ROOT/ascparser.cpp \
+    $$ROOT/gzipdevice.cpp
+
+HEADERS += \
+    $$ROOT/chipdb.h \
+    $$ROOT/chipdbimage.h \
+    $$ROOT/extractplan.h \
+    $$ROOT/ascparser.h \
+    $$ROOT/gzipdevice.h \
+    $$ROOT/tilegrid.h
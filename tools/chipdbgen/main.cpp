@@ -0,0 +1,152 @@
+// Compiles IceStorm chipdbs into the executable, as serialized chipdb images that
+// ChipDBImage::loadBuiltin() uses in place, such that the built-in devices are available
+// without parsing anything at startup.
+//
+// usage: chipdbgen CHIPDB.txt OUTPUT.cpp
+//        chipdbgen --index OUTPUT.cpp CHIPDB.txt...
+//
+// The chipdbs may also be gzip-compressed (CHIPDB.txt.gz). The images have the byte order of
+// the build host; if it differs from the target's, the built-in images are rejected when they
+// are loaded, like a stale cache.
+
+#include <QtDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <cstdio>
+#include "chipdb.h"
+#include "chipdbimage.h"
+#include "gzipdevice.h"
+
+static const int BYTES_PER_LINE = 24;
+
+static QString deviceOf(const QString &path)
+{
+    QString name = QFileInfo(path).fileName();
+    if(name.endsWith(".gz")) name.chop(3);
+    if(name.endsWith(".txt")) name.chop(4);
+    if(name.startsWith("chipdb-")) name.remove(0, 7);
+    return name;
+}
+
+static QByteArray identifierOf(const QString &device)
+{
+    QByteArray identifier = "builtinChipDB_";
+    for(char c : device.toLatin1()) {
+        bool valid = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+        identifier.append(valid ? c : '_');
+    }
+    return identifier;
+}
+
+// Rewriting an unchanged file would rebuild everything that depends on it.
+static bool writeIfChanged(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    if(file.open(QIODevice::ReadOnly) && file.readAll() == content) return true;
+    file.close();
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+       file.write(content) != content.size()) {
+        qCritical() << "cannot write" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+static bool generate(const QString &source, const QString &output)
+{
+    QFile file(source);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "cannot open" << source << file.errorString();
+        return false;
+    }
+
+    GzipDevice gzip(&file);
+    QIODevice *in = &file;
+    if(GzipDevice::isCompressed(&file)) {
+        gzip.open(QIODevice::ReadOnly);
+        in = &gzip;
+    }
+
+    ChipDB db;
+    db.name = deviceOf(source);
+    if(!db.parse(in, [](int, int) { return true; }, ChipDB::ParallelParse)) {
+        qCritical() << "cannot parse" << source;
+        return false;
+    }
+
+    QByteArray image = ChipDBImage::serialize(db);
+    if(image.isEmpty()) {
+        qCritical() << "cannot serialize" << source;
+        return false;
+    }
+
+    QByteArray identifier = identifierOf(deviceOf(source));
+    QByteArray content;
+    content += "// Generated by chipdbgen from " + QFileInfo(source).fileName().toUtf8() +
+               ". Do not edit.\n\n";
+    content += "#include <QtGlobal>\n\n";
+    // The image is used in place, so it needs the alignment of its records.
+    content += "alignas(8) extern const uchar " + identifier + "[] = {";
+    for(int index = 0; index < image.size(); index++) {
+        content += index % BYTES_PER_LINE ? " " : "\n    ";
+        content += QByteArray::number(uchar(image[index])) + ",";
+    }
+    content += "\n};\n";
+    content += "extern const qint64 " + identifier + "Size = " +
+               QByteArray::number(image.size()) + ";\n";
+    return writeIfChanged(output, content);
+}
+
+static bool generateIndex(const QString &output, const QStringList &sources)
+{
+    QByteArray content;
+    content += "// Generated by chipdbgen. Do not edit.\n\n";
+    content += "#include \"chipdbimage.h\"\n\n";
+    for(const QString &source : sources) {
+        QByteArray identifier = identifierOf(deviceOf(source));
+        content += "extern const uchar " + identifier + "[];\n";
+        content += "extern const qint64 " + identifier + "Size;\n";
+    }
+    content += "\nstatic const struct {\n";
+    content += "    const char *device;\n";
+    content += "    const uchar *data;\n";
+    content += "    const qint64 *size;\n";
+    content += "} BUILTINS[] = {\n";
+    for(const QString &source : sources) {
+        QString device        = deviceOf(source);
+        QByteArray identifier = identifierOf(device);
+        content += "    {\"" + device.toUtf8() + "\", " + identifier + ", &" + identifier +
+                   "Size},\n";
+    }
+    content += "    {nullptr, nullptr, nullptr},\n";
+    content += "};\n\n";
+    content += "bool ChipDBImage::loadBuiltin(const QString &device)\n{\n";
+    content += "    for(auto entry = BUILTINS; entry->device; entry++) {\n";
+    content += "        if(device == QLatin1String(entry->device)) {\n";
+    content += "            return load(entry->data, *entry->size);\n";
+    content += "        }\n";
+    content += "    }\n";
+    content += "    return false;\n";
+    content += "}\n";
+    return writeIfChanged(output, content);
+}
+
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for(int index = 1; index < argc; index++) {
+        args.append(QString::fromLocal8Bit(argv[index]));
+    }
+
+    if(args.size() >= 2 && args[0] == "--index") {
+        return generateIndex(args[1], args.mid(2)) ? 0 : 1;
+    } else if(args.size() == 2) {
+        return generate(args[0], args[1]) ? 0 : 1;
+    }
+
+    fprintf(stderr, "usage: chipdbgen CHIPDB.txt OUTPUT.cpp\n"
+                    "       chipdbgen --index OUTPUT.cpp CHIPDB.txt...\n");
+    return 2;
+}
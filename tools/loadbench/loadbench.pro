@@ -0,0 +1,41 @@
+# Not part of the default build; build it with `qmake tools/loadbench && make`.
+
+CONFIG  += c++11 console
+CONFIG  -= app_bundle
+QT       = core concurrent
+LIBS    += -lz
+
+TARGET   = loadbench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Like app.pro.
+bmi2:!msvc: QMAKE_CXXFLAGS += -mbmi2
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += \
+    main.cpp \
+    $$ROOT/chipdb.cpp \
+    $$ROOT/extractplan.cpp \
+    $$ROOT/ascparser.cpp \
+    $$ROOT/binparser.cpp \
+    $$ROOT/gzipdevice.cpp \
+    $$ROOT/bitstream.cpp \
+    $$ROOT/netgraph.cpp \
+    $$ROOT/symbolindex.cpp
+
+HEADERS += \
+    $$ROOT/chipdb.h \
+    $$ROOT/extractplan.h \
+    $$ROOT/ascparser.h \
+    $$ROOT/binparser.h \
+    $$ROOT/gzipdevice.h \
+    $$ROOT/bitstream.h \
+    $$ROOT/netgraph.h \
+    $$ROOT/symbolindex.h \
+    $$ROOT/packedbits.h \
+    $$ROOT/tilegrid.h \
+    $$ROOT/unionfind.h
@@ -0,0 +1,112 @@
+// Times parsing a chipdb, and parsing and processing a bitstream for it, the way the loaders
+// do. The best of several iterations is reported, so that changes to the parsers (e.g. to
+// the SIMD paths of the ASCII bitstream decoder) can be compared between builds.
+//
+// The peak resident memory is reported after the chipdb is parsed and after the bitstreams
+// are loaded. Each bitstream is allocated once and handed to another thread as a shared
+// handle, as BitstreamLoader hands it to the window, so no copy of it is made.
+//
+// usage: loadbench CHIPDB.txt BITSTREAM [ITERATIONS]
+
+#include <QtDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <cstdio>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+#include "bitstream.h"
+#include "chipdb.h"
+#include "gzipdevice.h"
+
+static const int DEFAULT_ITERATIONS = 10;
+
+// Opens `file`, and returns it or a device that decompresses it.
+static QIODevice *openInput(QFile *file, GzipDevice *gzip)
+{
+    if(!file->open(QIODevice::ReadOnly)) {
+        qCritical() << "cannot open" << file->fileName() << file->errorString();
+        return nullptr;
+    }
+
+    if(GzipDevice::isCompressed(file)) {
+        gzip->open(QIODevice::ReadOnly);
+        return gzip;
+    }
+    return file;
+}
+
+static double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+// In KiB, or -1 where it is unknown.
+static qint64 peakResidentKiB()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef Q_OS_MACOS
+    // In bytes on macOS.
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3) {
+        fprintf(stderr, "usage: loadbench CHIPDB.txt BITSTREAM [ITERATIONS]\n");
+        return 2;
+    }
+    int iterations = argc > 3 ? atoi(argv[3]) : DEFAULT_ITERATIONS;
+    auto progress  = [](int, int) { return true; };
+
+    QFile chipDBFile(QString::fromLocal8Bit(argv[1]));
+    GzipDevice chipDBGzip(&chipDBFile);
+    QIODevice *chipDBIn = openInput(&chipDBFile, &chipDBGzip);
+    if(!chipDBIn) return 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    ChipDB chipDB;
+    if(!chipDB.parse(chipDBIn, progress, ChipDB::ParallelParse)) return 1;
+    printf("chipdb parse: %.3f ms\n", elapsedMs(timer));
+    printf("chipdb memory: %lld KiB\n", chipDB.memorySize() / 1024);
+    printf("peak RSS after chipdb: %lld KiB\n", peakResidentKiB());
+
+    double bestParse = 0, bestProcess = 0;
+    for(int iteration = 0; iteration < iterations; iteration++) {
+        QFile file(QString::fromLocal8Bit(argv[2]));
+        GzipDevice gzip(&file);
+        QIODevice *in = openInput(&file, &gzip);
+        if(!in) return 1;
+
+        QSharedPointer<Bitstream> bitstream(new Bitstream);
+        timer.restart();
+        if(!bitstream->parse(in, progress)) return 1;
+        double parse = elapsedMs(timer);
+
+        timer.restart();
+        if(!bitstream->process(chipDB, ChipDB::ParallelParse)) return 1;
+        double process = elapsedMs(timer);
+
+        QSharedPointer<const Bitstream> handle = bitstream;
+        bitstream.clear();
+        QtConcurrent::run([handle] { return handle->clockDomains.size(); }).waitForFinished();
+
+        bestParse   = iteration ? qMin(bestParse, parse) : parse;
+        bestProcess = iteration ? qMin(bestProcess, process) : process;
+    }
+    printf("bitstream parse: %.3f ms\n", bestParse);
+    printf("bitstream process: %.3f ms\n", bestProcess);
+    printf("peak RSS after bitstreams: %lld KiB\n", peakResidentKiB());
+    return 0;
+}
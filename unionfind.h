@@ -0,0 +1,52 @@
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <QVector>
+
+// Partitions the integers 0 up to `size` into disjoint sets, which start out as one set per
+// integer. Sets are merged by rank and paths are halved as they are followed, so any sequence
+// of operations takes nearly linear time.
+class UnionFind
+{
+public:
+    explicit UnionFind(int size) : _parents(size), _ranks(size, 0)
+    {
+        for(int index = 0; index < size; index++) {
+            _parents[index] = index;
+        }
+    }
+
+    int size() const
+    {
+        return _parents.size();
+    }
+
+    // Returns the representative of the set containing `index`.
+    int find(int index)
+    {
+        while(_parents[index] != index) {
+            _parents[index] = _parents[_parents[index]];
+            index           = _parents[index];
+        }
+        return index;
+    }
+
+    // Merges the sets containing `a` and `b`, and returns false if they were the same.
+    bool unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if(a == b) return false;
+
+        if(_ranks[a] < _ranks[b]) qSwap(a, b);
+        _parents[b] = a;
+        if(_ranks[a] == _ranks[b]) _ranks[a]++;
+        return true;
+    }
+
+private:
+    QVector<int> _parents;
+    QVector<quint8> _ranks;
+};
+
+#endif // UNIONFIND_H